@@ -2,10 +2,21 @@
 #include <string_view>
 #include "../../src/Camera.hpp"
 #include "../../src/EventsCallbacks.hpp"
+#include "../../src/FramePacing.hpp"
+#include "../../src/ImageWriter.hpp"
+#include "../../src/LinearArena.hpp"
 #include "../../src/Mesh.hpp"
+#include "../../src/PixelReadback.hpp"
 #include "../../src/RenderTarget.hpp"
+#include "../../src/RenderTargetPool.hpp"
+#include "../../src/Sampler.hpp"
 #include "../../src/Shader.hpp"
+#include "../../src/ShaderWatcher.hpp"
 #include "../../src/Texture.hpp"
+#include "../../src/TextureAtlas.hpp"
+#include "../../src/TextureLoader.hpp"
+#include "../../src/VideoWriter.hpp"
+#include "../../src/has_extension.hpp"
 #include "../../src/make_absolute_path.hpp"
 #include "glad/gl.h"
 #include "glm/glm.hpp"
@@ -18,6 +29,11 @@ void init(std::string_view window_title);
 
 void maximize_window();
 
+/// VSync::On by default
+void set_vsync(VSync);
+/// Caps the frame rate by waiting in window_is_open(), e.g. to save power when vsync is off. 0 (the default) removes the cap.
+void set_max_frames_per_second(double max_frames_per_second);
+
 void set_events_callbacks(std::vector<EventsCallbacks>);
 
 /// Must only be used as the condition of a while loop: `while(gl::window_is_open()) {/*do your rendering here*/}`
@@ -31,8 +47,11 @@ auto window_width_in_screen_coordinates() -> int;
 auto window_height_in_screen_coordinates() -> int;
 auto window_aspect_ratio() -> float;
 
-auto time_in_seconds() -> float;
+/// Monotonic, in double precision so that it stays precise even after weeks of uptime
+auto time_in_seconds() -> double;
 auto delta_time_in_seconds() -> float;
+/// Statistics over the durations of the last frames
+auto frame_times() -> FrameTimes;
 
 auto mouse_position() -> glm::vec2;
 
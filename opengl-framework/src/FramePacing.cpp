@@ -0,0 +1,72 @@
+#include "FramePacing.hpp"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace gl::internal {
+
+void FrameTimesHistory::push(double delta_time)
+{
+    _durations[_next] = delta_time;
+    _next             = (_next + 1) % _durations.size();
+    _count            = std::min(_count + 1, _durations.size());
+    // Roughly averages the last 20 frames, and starts at the first value instead of climbing from 0
+    _smoothed = _count == 1 ? delta_time : _smoothed + 0.1 * (delta_time - _smoothed);
+}
+
+auto FrameTimesHistory::compute() const -> FrameTimes
+{
+    if (_count == 0)
+        return {};
+
+    auto sorted = _durations;
+    std::sort(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(_count));
+    auto const percentile = [&](double p) {
+        return sorted[std::min(static_cast<size_t>(p * static_cast<double>(_count)), _count - 1)];
+    };
+    return FrameTimes{
+        .smoothed      = _smoothed,
+        .median        = percentile(0.5),
+        .percentile_95 = percentile(0.95),
+        .percentile_99 = percentile(0.99),
+        .max           = sorted[_count - 1],
+    };
+}
+
+void FrameLimiter::set_max_frames_per_second(double max_frames_per_second)
+{
+    _period          = max_frames_per_second > 0. ? 1. / max_frames_per_second : 0.;
+    _next_frame_time = 0.;
+}
+
+void FrameLimiter::wait()
+{
+    if (_period <= 0.)
+        return;
+    double const now = monotonic_time();
+    // Aim at a fixed rhythm, so that the small errors of each wait don't add up.
+    // But if we are more than a frame late, start again from now instead of rushing the next frames to catch up.
+    if (_next_frame_time == 0. || now - _next_frame_time > _period)
+        _next_frame_time = now;
+    wait_until(_next_frame_time);
+    _next_frame_time += _period;
+}
+
+auto monotonic_time() -> double
+{
+    using namespace std::chrono;
+    static auto const start = steady_clock::now();
+    return duration<double>{steady_clock::now() - start}.count();
+}
+
+void wait_until(double time)
+{
+    static constexpr double spin_duration = 0.002; // More than the usual oversleep of the OS
+    double const            remaining     = time - monotonic_time();
+    if (remaining > spin_duration)
+        std::this_thread::sleep_for(std::chrono::duration<double>{remaining - spin_duration});
+    while (monotonic_time() < time)
+        std::this_thread::yield();
+}
+
+} // namespace gl::internal
@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include <cstddef>
+
+namespace gl {
+
+enum class VSync {
+    Off,      // Frames are shown as soon as they are ready, which can tear
+    On,       // Waits for the vertical blank before showing a frame
+    Adaptive, // Like On, but a frame that missed the vertical blank is shown immediately (a bit of tearing instead of a stutter). Falls back to On when the driver doesn't support it.
+};
+
+/// Statistics over the durations of the last frames, in seconds
+struct FrameTimes {
+    double smoothed{0.};      // Exponential moving average, good to display a stable frame rate
+    double median{0.};
+    double percentile_95{0.};
+    double percentile_99{0.}; // Stutters show up here long before they move the average
+    double max{0.};
+};
+
+namespace internal {
+
+/// The last frame durations, to compute FrameTimes
+class FrameTimesHistory {
+public:
+    void push(double delta_time);
+    auto compute() const -> FrameTimes;
+
+private:
+    std::array<double, 256> _durations{};
+    size_t                  _count{0};
+    size_t                  _next{0};
+    double                  _smoothed{0.};
+};
+
+/// Paces the frames to a maximum rate
+class FrameLimiter {
+public:
+    /// 0 removes the limit
+    void set_max_frames_per_second(double max_frames_per_second);
+    /// Blocks until it is time to start the next frame
+    void wait();
+
+private:
+    double _period{0.};
+    double _next_frame_time{0.};
+};
+
+/// Monotonic time in seconds, in double precision so that it stays precise after weeks of uptime
+auto monotonic_time() -> double;
+
+/// Sleeps most of the way and spins for the last bit, because sleeps can overshoot by a few milliseconds (especially on Windows)
+void wait_until(double time);
+
+} // namespace internal
+
+} // namespace gl
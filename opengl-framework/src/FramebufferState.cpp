@@ -0,0 +1,35 @@
+#include "FramebufferState.hpp"
+
+namespace gl::internal {
+
+static auto current_state() -> FramebufferState&
+{
+    static auto instance = FramebufferState{};
+    return instance;
+}
+
+auto framebuffer_state() -> FramebufferState const&
+{
+    return current_state();
+}
+
+void set_framebuffer_state(FramebufferState const& state)
+{
+    auto& current = current_state();
+    if (state.draw_framebuffer != current.draw_framebuffer)
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, state.draw_framebuffer);
+    if (state.read_framebuffer != current.read_framebuffer)
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, state.read_framebuffer);
+    if (state.viewport_x != current.viewport_x || state.viewport_y != current.viewport_y || state.viewport_width != current.viewport_width || state.viewport_height != current.viewport_height)
+        glViewport(state.viewport_x, state.viewport_y, state.viewport_width, state.viewport_height);
+    current = state;
+}
+
+void bind_read_framebuffer(GLuint framebuffer)
+{
+    auto state             = framebuffer_state();
+    state.read_framebuffer = framebuffer;
+    set_framebuffer_state(state);
+}
+
+} // namespace gl::internal
@@ -0,0 +1,23 @@
+#pragma once
+#include "glad/gl.h"
+
+namespace gl::internal {
+
+struct FramebufferState {
+    GLuint  draw_framebuffer{0};
+    GLuint  read_framebuffer{0};
+    GLint   viewport_x{0};
+    GLint   viewport_y{0};
+    GLsizei viewport_width{0};
+    GLsizei viewport_height{0};
+};
+
+/// The framebuffers and viewport currently bound, as tracked by the framework.
+/// The framework changes them only through the functions below, so that it never needs to query OpenGL with glGet, which can stall the pipeline on some drivers.
+/// If you call glBindFramebuffer() or glViewport() yourself, restore the previous values before giving control back to the framework.
+auto framebuffer_state() -> FramebufferState const&;
+/// Only calls OpenGL for the values that actually change
+void set_framebuffer_state(FramebufferState const&);
+void bind_read_framebuffer(GLuint framebuffer);
+
+} // namespace gl::internal
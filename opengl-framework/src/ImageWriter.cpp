@@ -0,0 +1,79 @@
+#include "ImageWriter.hpp"
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include "img/img.hpp"
+
+namespace gl {
+
+ImageWriter::ImageWriter(size_t max_queued_images)
+    : _max_queued_images{std::max(max_queued_images, size_t{1})}
+    , _thread{[this]() { encode_loop(); }}
+{
+}
+
+ImageWriter::~ImageWriter()
+{
+    {
+        std::scoped_lock lock{_mutex};
+        _stopping = true;
+    }
+    _queue_changed.notify_all();
+    _thread.join();
+}
+
+void ImageWriter::save(std::filesystem::path path, ReadPixels pixels)
+{
+    {
+        std::unique_lock lock{_mutex};
+        _queue_changed.wait(lock, [&]() { return _queue.size() < _max_queued_images; });
+        _queue.push_back({std::move(path), std::move(pixels)});
+    }
+    _queue_changed.notify_all();
+}
+
+auto ImageWriter::queued_count() -> size_t
+{
+    std::scoped_lock lock{_mutex};
+    return _queue.size();
+}
+
+static auto is_jpeg(std::filesystem::path const& path) -> bool
+{
+    auto const extension = path.extension();
+    return extension == ".jpg" || extension == ".jpeg" || extension == ".JPG" || extension == ".JPEG";
+}
+
+void ImageWriter::encode_loop()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock lock{_mutex};
+            _queue_changed.wait(lock, [&]() { return _stopping || !_queue.empty(); });
+            if (_queue.empty())
+                return; // Stopping, and everything has been saved
+            job = std::move(_queue.front());
+            _queue.pop_front();
+        }
+        _queue_changed.notify_all(); // There is room in the queue again
+
+        // handle_error() would throw on this thread and terminate the program, so we only report the error
+        try
+        {
+            auto const width  = static_cast<img::Size::DataType>(job.pixels.width);
+            auto const height = static_cast<img::Size::DataType>(job.pixels.height);
+            if (is_jpeg(job.path))
+                img::save_jpeg(job.path, width, height, job.pixels.data.data(), 4, /*flip_vertically=*/true);
+            else
+                img::save_png(job.path, width, height, job.pixels.data.data(), 4, /*flip_vertically=*/true);
+        }
+        catch (std::exception const& e)
+        {
+            std::cerr << "[ImageWriter] Failed to save \"" << job.path.string() << "\": " << e.what() << '\n';
+        }
+    }
+}
+
+} // namespace gl
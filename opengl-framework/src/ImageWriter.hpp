@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include "PixelReadback.hpp"
+
+namespace gl {
+
+/// Encodes and saves images on a background thread, so that capturing a sequence of frames doesn't slow down the rendering.
+/// The file format is deduced from the extension: .jpg and .jpeg are saved as JPEG, everything else as PNG.
+class ImageWriter {
+public:
+    /// save() blocks when max_queued_images are already waiting to be encoded
+    explicit ImageWriter(size_t max_queued_images = 8);
+    /// Waits until all the queued images have been saved
+    ~ImageWriter();
+    ImageWriter(ImageWriter const&)                    = delete; // You cannot copy
+    auto operator=(ImageWriter const&) -> ImageWriter& = delete; // nor move an ImageWriter, its thread refers to it
+
+    void save(std::filesystem::path path, ReadPixels pixels);
+
+    auto queued_count() -> size_t;
+
+private:
+    struct Job {
+        std::filesystem::path path;
+        ReadPixels            pixels;
+    };
+
+    void encode_loop();
+
+private:
+    size_t                  _max_queued_images;
+    std::mutex              _mutex{};
+    std::condition_variable _queue_changed{};
+    std::deque<Job>         _queue{};
+    bool                    _stopping{false};
+    std::thread             _thread{};
+};
+
+} // namespace gl
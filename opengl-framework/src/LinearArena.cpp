@@ -0,0 +1,60 @@
+#include "LinearArena.hpp"
+#include <algorithm>
+#include <numeric>
+
+namespace gl {
+
+LinearArena::LinearArena(size_t initial_capacity)
+{
+    add_block(initial_capacity);
+}
+
+void LinearArena::add_block(size_t size)
+{
+    _blocks.push_back(Block{std::make_unique_for_overwrite<std::byte[]>(size), size});
+    _heap_allocations_count++;
+}
+
+auto LinearArena::capacity() const -> size_t
+{
+    return std::accumulate(_blocks.begin(), _blocks.end(), size_t{0}, [](size_t total, Block const& block) { return total + block.size; });
+}
+
+auto LinearArena::do_allocate(size_t bytes, size_t alignment) -> void*
+{
+    {
+        Block& block = _blocks.back();
+        void*  ptr   = block.memory.get() + _offset;
+        size_t space = block.size - _offset;
+        if (std::align(alignment, bytes, ptr, space) != nullptr)
+        {
+            _offset = block.size - space + bytes;
+            return ptr;
+        }
+    }
+    // Doesn't fit, continue in a new block, at least twice as big so that we quickly stop needing new ones
+    _used_in_previous_blocks += _offset;
+    _offset = 0;
+    add_block(std::max(_blocks.back().size * 2, bytes + alignment));
+    return do_allocate(bytes, alignment);
+}
+
+void LinearArena::reset()
+{
+    if (_blocks.size() > 1)
+    {
+        size_t const total = capacity();
+        _blocks.clear();
+        add_block(total);
+    }
+    _offset                  = 0;
+    _used_in_previous_blocks = 0;
+}
+
+auto frame_arena() -> LinearArena&
+{
+    thread_local LinearArena instance{};
+    return instance;
+}
+
+} // namespace gl
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace gl {
+
+/// Allocator for scratch memory that only lives for a short time, e.g. one frame.
+/// Allocating is just bumping a pointer, and deallocating does nothing: all the memory is given back at once by reset().
+/// It is a std::pmr::memory_resource, so that it can be given to any std::pmr container: `std::pmr::vector<int> v{&gl::frame_arena()};`
+/// When it runs out of memory it asks the heap for a bigger block, and reset() merges all the blocks into a single one,
+/// so that once it has grown to the size of a frame it never allocates again.
+class LinearArena final : public std::pmr::memory_resource {
+public:
+    explicit LinearArena(size_t initial_capacity = 64 * 1024);
+
+    /// Invalidates everything that has been allocated from the arena
+    void reset();
+
+    auto used_bytes() const -> size_t { return _used_in_previous_blocks + _offset; }
+    auto capacity() const -> size_t;
+    /// Number of times the arena had to ask the heap for memory. Stops increasing once the arena is big enough.
+    auto heap_allocations_count() const -> size_t { return _heap_allocations_count; }
+
+private:
+    auto do_allocate(size_t bytes, size_t alignment) -> void* override;
+    void do_deallocate(void*, size_t, size_t) override {} // Memory is only given back by reset()
+    auto do_is_equal(std::pmr::memory_resource const& other) const noexcept -> bool override { return this == &other; }
+
+    void add_block(size_t size);
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> memory;
+        size_t                       size;
+    };
+    std::vector<Block> _blocks{};
+    size_t             _offset{0}; // In the last block
+    size_t             _used_in_previous_blocks{0};
+    size_t             _heap_allocations_count{0};
+};
+
+/// Arena of the calling thread. The one of the main thread is reset at the top of window_is_open(), so its memory must not be kept across frames.
+/// The other threads have their own frames, and must reset their arena when they end one (e.g. at the end of a job, or of a simulation step).
+auto frame_arena() -> LinearArena&;
+
+} // namespace gl
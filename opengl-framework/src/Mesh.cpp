@@ -17,12 +17,26 @@ static auto type(AnyVertexAttribute const& attr)
 {
     return std::visit([](auto&& attr) { return attr.type(); }, attr);
 }
+static auto is_normalized(AnyVertexAttribute const& attr)
+{
+    return std::visit([](auto&& attr) { return attr.is_normalized(); }, attr);
+}
 static auto size_in_bytes(AnyVertexAttribute const& attr)
 {
-    return size(attr) * 4;
+    return std::visit([](auto&& attr) { return attr.size_in_bytes(); }, attr);
+}
+static auto is_integer(GLenum type)
+{
+    return type == GL_INT;
+}
+
+static auto triangles_count(size_t size_in_bytes, GLsizei stride) -> size_t
+{
+    assert(size_in_bytes % static_cast<size_t>(stride) == 0 && "The size of the data is not a multiple of the size of a vertex. Make sure that the layout matches the data.");
+    return size_in_bytes / static_cast<size_t>(stride) / 3;
 }
 
-Mesh::Mesh(Mesh_Descriptor desc)
+Mesh::Mesh(Mesh_Descriptor const& desc)
 {
     assert(!desc.vertex_buffers.empty() && "You must provide at least one vertex buffer to construct a mesh.");
 
@@ -38,31 +52,38 @@ Mesh::Mesh(Mesh_Descriptor desc)
     }
 
     { // Vertex Buffers
-        _vertex_buffers.resize(desc.vertex_buffers.size());
-        glGenBuffers(static_cast<int>(_vertex_buffers.size()), _vertex_buffers.data());
-        for (size_t i = 0; i < _vertex_buffers.size(); ++i)
+        bool is_first_per_vertex_buffer = true;
+        for (size_t i = 0; i < desc.vertex_buffers.size(); ++i)
         {
-            glBindBuffer(GL_ARRAY_BUFFER, _vertex_buffers[i]);
-            glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(desc.vertex_buffers[i].data.size() * sizeof(GLfloat)), desc.vertex_buffers[i].data.data(), GL_STATIC_DRAW);
-
-            int const stride = std::accumulate(desc.vertex_buffers[i].layout.begin(), desc.vertex_buffers[i].layout.end(), 0, [](int acc, AnyVertexAttribute const& attr) {
+            auto const& buffer_desc = desc.vertex_buffers[i];
+            auto const  stride      = std::accumulate(buffer_desc.layout.begin(), buffer_desc.layout.end(), GLsizei{0}, [](GLsizei acc, AnyVertexAttribute const& attr) {
                 return acc + size_in_bytes(attr);
             });
-            if (desc.index_buffer.empty())
+            auto& buffer = _vertex_buffers.emplace_back(VertexBuffer{
+                .layout     = buffer_desc.layout,
+                .stride     = stride,
+                .divisor    = buffer_desc.divisor,
+                .is_dynamic = buffer_desc.is_dynamic,
+            });
+            glGenBuffers(1, &buffer.id);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer.id);
+            glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(buffer_desc.data.size()), buffer_desc.data.data(), buffer.is_dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+
+            if (desc.index_buffer.empty() && buffer.divisor == 0)
             {
-                auto const triangles_count = desc.vertex_buffers[i].data.size() / (stride / sizeof(float)) / 3;
-                if (i == 0)
-                    _triangles_count = triangles_count;
+                auto const count = triangles_count(buffer_desc.data.size(), buffer.stride);
+                if (is_first_per_vertex_buffer)
+                    _triangles_count = count;
                 else
-                    assert(_triangles_count == triangles_count && "Some vertex buffers contain more vertices than others! Make sure that their data is correct, and that the layout matches the data.");
+                    assert(_triangles_count == count && "Some vertex buffers contain more vertices than others! Make sure that their data is correct, and that the layout matches the data.");
+                is_first_per_vertex_buffer = false;
             }
-            uint64_t pointer{0};
-            for (auto const& attribute : desc.vertex_buffers[i].layout)
+            for (auto const& attribute : buffer.layout)
             {
-                glEnableVertexAttribArray(index(attribute));
-                glVertexAttribPointer(index(attribute), size(attribute), type(attribute), GL_FALSE, stride, reinterpret_cast<void*>(pointer)); // NOLINT(*reinterpret-cast, performance-no-int-to-ptr)
-                pointer += size_in_bytes(attribute);
+                glEnableVertexAttribArray(static_cast<GLuint>(index(attribute)));
+                glVertexAttribDivisor(static_cast<GLuint>(index(attribute)), buffer.divisor);
             }
+            set_attribute_pointers(i, 0);
         }
     }
 
@@ -71,25 +92,67 @@ Mesh::Mesh(Mesh_Descriptor desc)
         {
             glGenBuffers(1, &_maybe_index_buffer);
             glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _maybe_index_buffer);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(desc.index_buffer.size() * sizeof(uint32_t)), desc.index_buffer.data(), GL_STATIC_DRAW);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, static_cast<GLsizeiptr>(desc.index_buffer.size_bytes()), desc.index_buffer.data(), GL_STATIC_DRAW);
         }
     }
 }
 
+void Mesh::set_attribute_pointers(size_t buffer_index, GLsizei first_instance) const
+{
+    auto const& buffer = _vertex_buffers[buffer_index];
+    glBindBuffer(GL_ARRAY_BUFFER, buffer.id);
+    // Starts first_instance / divisor elements later. This is what glDrawArraysInstancedBaseInstance() does, but it needs OpenGL 4.2 which MacOS doesn't have.
+    auto pointer = buffer.divisor == 0 ? uint64_t{0} : static_cast<uint64_t>(first_instance / static_cast<GLsizei>(buffer.divisor)) * static_cast<uint64_t>(buffer.stride);
+    for (auto const& attribute : buffer.layout)
+    {
+        auto const attribute_index = static_cast<GLuint>(index(attribute));
+        if (is_integer(type(attribute)))
+            glVertexAttribIPointer(attribute_index, size(attribute), type(attribute), buffer.stride, reinterpret_cast<void*>(pointer)); // NOLINT(*reinterpret-cast, performance-no-int-to-ptr)
+        else
+            glVertexAttribPointer(attribute_index, size(attribute), type(attribute), is_normalized(attribute) ? GL_TRUE : GL_FALSE, buffer.stride, reinterpret_cast<void*>(pointer)); // NOLINT(*reinterpret-cast, performance-no-int-to-ptr)
+        pointer += static_cast<uint64_t>(size_in_bytes(attribute));
+    }
+}
+
 void Mesh::draw() const
+{
+    draw_instances(1);
+}
+
+void Mesh::draw_instances(GLsizei instances_count, GLsizei first_instance) const
 {
     glBindVertexArray(_vertex_array);
+    if (first_instance != _bound_first_instance)
+    {
+        for (size_t i = 0; i < _vertex_buffers.size(); ++i)
+        {
+            if (_vertex_buffers[i].divisor != 0)
+                set_attribute_pointers(i, first_instance);
+        }
+        _bound_first_instance = first_instance;
+    }
     if (_maybe_index_buffer != 0)
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(3 * _triangles_count), GL_UNSIGNED_INT, reinterpret_cast<void*>(0)); // NOLINT(*reinterpret-cast)
+        glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(3 * _triangles_count), GL_UNSIGNED_INT, reinterpret_cast<void*>(0), instances_count); // NOLINT(*reinterpret-cast)
     else
-        glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(3 * _triangles_count));
+        glDrawArraysInstanced(GL_TRIANGLES, 0, static_cast<GLsizei>(3 * _triangles_count), instances_count);
+}
+
+void Mesh::update_vertex_buffer(size_t buffer_index, std::span<std::byte const> data)
+{
+    assert(buffer_index < _vertex_buffers.size());
+    auto const& buffer = _vertex_buffers[buffer_index];
+    glBindBuffer(GL_ARRAY_BUFFER, buffer.id);
+    // Giving the whole buffer again lets the driver hand us fresh memory instead of waiting for the draws that still use the previous content
+    glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(data.size()), data.data(), buffer.is_dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
+    if (_maybe_index_buffer == 0 && buffer.divisor == 0)
+        _triangles_count = triangles_count(data.size(), buffer.stride);
 }
 
 Mesh::~Mesh()
 {
     glDeleteVertexArrays(1, &_vertex_array);
-    if (!_vertex_buffers.empty()) // Might have been moved-from
-        glDeleteBuffers(static_cast<int>(_vertex_buffers.size()), _vertex_buffers.data());
+    for (auto const& buffer : _vertex_buffers) // Might be empty if the mesh has been moved-from
+        glDeleteBuffers(1, &buffer.id);
     glDeleteBuffers(1, &_maybe_index_buffer);
 }
 
@@ -98,6 +161,7 @@ Mesh::Mesh(Mesh&& o) noexcept
     , _vertex_buffers{std::move(o._vertex_buffers)}
     , _maybe_index_buffer{o._maybe_index_buffer}
     , _triangles_count{o._triangles_count}
+    , _bound_first_instance{o._bound_first_instance}
 {
     o._vertex_array = 0;
     o._vertex_buffers.resize(0);
@@ -110,15 +174,16 @@ auto Mesh::operator=(Mesh&& o) noexcept -> Mesh&
     {
         // Delete this
         glDeleteVertexArrays(1, &_vertex_array);
-        if (!_vertex_buffers.empty()) // Might have been moved-from
-            glDeleteBuffers(static_cast<int>(_vertex_buffers.size()), _vertex_buffers.data());
+        for (auto const& buffer : _vertex_buffers) // Might be empty if the mesh has been moved-from
+            glDeleteBuffers(1, &buffer.id);
         glDeleteBuffers(1, &_maybe_index_buffer);
 
         // Move
-        _vertex_array       = o._vertex_array;
-        _vertex_buffers     = std::move(o._vertex_buffers);
-        _maybe_index_buffer = o._maybe_index_buffer;
-        _triangles_count    = o._triangles_count;
+        _vertex_array         = o._vertex_array;
+        _vertex_buffers       = std::move(o._vertex_buffers);
+        _maybe_index_buffer   = o._maybe_index_buffer;
+        _triangles_count      = o._triangles_count;
+        _bound_first_instance = o._bound_first_instance;
 
         o._vertex_array = 0;
         o._vertex_buffers.resize(0);
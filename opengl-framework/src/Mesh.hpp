@@ -1,4 +1,7 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <variant>
 #include <vector>
 #include "glad/gl.h"
@@ -25,48 +28,115 @@ public:
     using VertexAttribute_Base::VertexAttribute_Base;
     static auto size() -> GLint { return 1; }
     static auto type() -> GLenum { return GL_FLOAT; }
+    static auto is_normalized() -> bool { return false; }
+    static auto size_in_bytes() -> GLsizei { return 4; }
 };
 class Vec2 : public internal::VertexAttribute_Base {
 public:
     using VertexAttribute_Base::VertexAttribute_Base;
     static auto size() -> GLint { return 2; }
     static auto type() -> GLenum { return GL_FLOAT; }
+    static auto is_normalized() -> bool { return false; }
+    static auto size_in_bytes() -> GLsizei { return 8; }
 };
 class Vec3 : public internal::VertexAttribute_Base {
 public:
     using VertexAttribute_Base::VertexAttribute_Base;
     static auto size() -> GLint { return 3; }
     static auto type() -> GLenum { return GL_FLOAT; }
+    static auto is_normalized() -> bool { return false; }
+    static auto size_in_bytes() -> GLsizei { return 12; }
 };
 class Vec4 : public internal::VertexAttribute_Base {
 public:
     using VertexAttribute_Base::VertexAttribute_Base;
     static auto size() -> GLint { return 4; }
     static auto type() -> GLenum { return GL_FLOAT; }
+    static auto is_normalized() -> bool { return false; }
+    static auto size_in_bytes() -> GLsizei { return 16; }
 };
 class Int : public internal::VertexAttribute_Base {
 public:
     using VertexAttribute_Base::VertexAttribute_Base;
     static auto size() -> GLint { return 1; }
     static auto type() -> GLenum { return GL_INT; }
+    static auto is_normalized() -> bool { return false; }
+    static auto size_in_bytes() -> GLsizei { return 4; }
 };
 class IVec2 : public internal::VertexAttribute_Base {
 public:
     using VertexAttribute_Base::VertexAttribute_Base;
     static auto size() -> GLint { return 2; }
     static auto type() -> GLenum { return GL_INT; }
+    static auto is_normalized() -> bool { return false; }
+    static auto size_in_bytes() -> GLsizei { return 8; }
 };
 class IVec3 : public internal::VertexAttribute_Base {
 public:
     using VertexAttribute_Base::VertexAttribute_Base;
     static auto size() -> GLint { return 3; }
     static auto type() -> GLenum { return GL_INT; }
+    static auto is_normalized() -> bool { return false; }
+    static auto size_in_bytes() -> GLsizei { return 12; }
 };
 class IVec4 : public internal::VertexAttribute_Base {
 public:
     using VertexAttribute_Base::VertexAttribute_Base;
     static auto size() -> GLint { return 4; }
     static auto type() -> GLenum { return GL_INT; }
+    static auto is_normalized() -> bool { return false; }
+    static auto size_in_bytes() -> GLsizei { return 16; }
+};
+/// 16-bits float, e.g. from glm::packHalf1x16(). Read as a float in the shader.
+class Half : public internal::VertexAttribute_Base {
+public:
+    using VertexAttribute_Base::VertexAttribute_Base;
+    static auto size() -> GLint { return 1; }
+    static auto type() -> GLenum { return GL_HALF_FLOAT; }
+    static auto is_normalized() -> bool { return false; }
+    static auto size_in_bytes() -> GLsizei { return 2; }
+};
+class HalfVec2 : public internal::VertexAttribute_Base {
+public:
+    using VertexAttribute_Base::VertexAttribute_Base;
+    static auto size() -> GLint { return 2; }
+    static auto type() -> GLenum { return GL_HALF_FLOAT; }
+    static auto is_normalized() -> bool { return false; }
+    static auto size_in_bytes() -> GLsizei { return 4; }
+};
+class HalfVec4 : public internal::VertexAttribute_Base {
+public:
+    using VertexAttribute_Base::VertexAttribute_Base;
+    static auto size() -> GLint { return 4; }
+    static auto type() -> GLenum { return GL_HALF_FLOAT; }
+    static auto is_normalized() -> bool { return false; }
+    static auto size_in_bytes() -> GLsizei { return 8; }
+};
+/// Bytes mapped from [0, 255] to [0, 1], read as a vec4 in the shader
+class UNorm8Vec4 : public internal::VertexAttribute_Base {
+public:
+    using VertexAttribute_Base::VertexAttribute_Base;
+    static auto size() -> GLint { return 4; }
+    static auto type() -> GLenum { return GL_UNSIGNED_BYTE; }
+    static auto is_normalized() -> bool { return true; }
+    static auto size_in_bytes() -> GLsizei { return 4; }
+};
+/// Unsigned shorts mapped from [0, 65535] to [0, 1], read as a vec2 in the shader
+class UNorm16Vec2 : public internal::VertexAttribute_Base {
+public:
+    using VertexAttribute_Base::VertexAttribute_Base;
+    static auto size() -> GLint { return 2; }
+    static auto type() -> GLenum { return GL_UNSIGNED_SHORT; }
+    static auto is_normalized() -> bool { return true; }
+    static auto size_in_bytes() -> GLsizei { return 4; }
+};
+class UNorm16Vec4 : public internal::VertexAttribute_Base {
+public:
+    using VertexAttribute_Base::VertexAttribute_Base;
+    static auto size() -> GLint { return 4; }
+    static auto type() -> GLenum { return GL_UNSIGNED_SHORT; }
+    static auto is_normalized() -> bool { return true; }
+    static auto size_in_bytes() -> GLsizei { return 8; }
 };
 
 using Position2D = Vec2;
@@ -75,6 +145,7 @@ using Normal3D   = Vec3;
 using UV         = Vec2;
 using ColorRGB   = Vec3;
 using ColorRGBA  = Vec4;
+using ColorRGBA8 = UNorm8Vec4;
 } // namespace VertexAttribute
 
 using AnyVertexAttribute = std::variant<
@@ -85,21 +156,29 @@ using AnyVertexAttribute = std::variant<
     VertexAttribute::Int,
     VertexAttribute::IVec2,
     VertexAttribute::IVec3,
-    VertexAttribute::IVec4>;
+    VertexAttribute::IVec4,
+    VertexAttribute::Half,
+    VertexAttribute::HalfVec2,
+    VertexAttribute::HalfVec4,
+    VertexAttribute::UNorm8Vec4,
+    VertexAttribute::UNorm16Vec2,
+    VertexAttribute::UNorm16Vec4>;
 
 struct VertexBuffer_Descriptor {
-    std::vector<AnyVertexAttribute> const& layout; // NOLINT(*avoid-const-or-ref-data-members)
-    std::vector<float> const&              data;   // NOLINT(*avoid-const-or-ref-data-members)
+    std::vector<AnyVertexAttribute> layout{}; /// Attributes are tightly packed, in this order, with no padding between them
+    std::span<std::byte const>      data{};   /// The bytes of your vertices, e.g. std::as_bytes(std::span{my_vertices}). Copied to the GPU, you don't need to keep them alive.
+    GLuint                          divisor{0};        /// 0 means one value per vertex, 1 one value per instance (see Mesh::draw_instances()), N one value every N instances
+    bool                            is_dynamic{false}; /// Set it if you plan to update_vertex_buffer() often
 };
 
 struct Mesh_Descriptor {
-    std::vector<VertexBuffer_Descriptor> const& vertex_buffers; // NOLINT(*avoid-const-or-ref-data-members)
-    std::vector<uint32_t> const&                index_buffer{};
+    std::vector<VertexBuffer_Descriptor> vertex_buffers{};
+    std::span<uint32_t const>            index_buffer{};
 };
 
 class Mesh {
 public:
-    explicit Mesh(Mesh_Descriptor);
+    explicit Mesh(Mesh_Descriptor const&);
     ~Mesh();
     Mesh(Mesh const&)                    = delete; // You cannot copy
     auto operator=(Mesh const&) -> Mesh& = delete; // a Mesh. But you can move it, using std::move(my_mesh)
@@ -107,13 +186,30 @@ public:
     auto operator=(Mesh&&) noexcept -> Mesh&;
 
     void draw() const;
+    /// Draws the mesh instances_count times. Vertex buffers with a divisor start reading at first_instance.
+    void draw_instances(GLsizei instances_count, GLsizei first_instance = 0) const;
+
+    /// Replaces the content of a vertex buffer. Its size can change, which for a buffer with a divisor of 0 changes the number of triangles drawn.
+    void update_vertex_buffer(size_t buffer_index, std::span<std::byte const> data);
 
 private:
-    GLuint              _vertex_array{};
-    std::vector<GLuint> _vertex_buffers{};
-    GLuint              _maybe_index_buffer{};
+    void set_attribute_pointers(size_t buffer_index, GLsizei first_instance) const;
+
+private:
+    struct VertexBuffer {
+        GLuint                          id{};
+        std::vector<AnyVertexAttribute> layout{};
+        GLsizei                         stride{};
+        GLuint                          divisor{};
+        bool                            is_dynamic{};
+    };
+
+    GLuint                    _vertex_array{};
+    std::vector<VertexBuffer> _vertex_buffers{};
+    GLuint                    _maybe_index_buffer{};
 
-    size_t _triangles_count{};
+    size_t          _triangles_count{};
+    mutable GLsizei _bound_first_instance{0}; // Instanced attributes only need to be pointed at another instance when first_instance changes
 };
 
 } // namespace gl
\ No newline at end of file
@@ -0,0 +1,140 @@
+#include "PixelReadback.hpp"
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include "FramebufferState.hpp"
+#include "handle_error.hpp"
+
+namespace gl {
+
+PixelReadback::PixelReadback(size_t buffers_count)
+    : _slots(buffers_count)
+{
+    assert(buffers_count > 0);
+}
+
+PixelReadback::~PixelReadback()
+{
+    for (auto& slot : _slots)
+        glDeleteSync(slot.fence); // Deleting a null sync is a no-op
+}
+
+PixelReadback::PixelReadback(PixelReadback&& o) noexcept
+    : _slots{std::move(o._slots)}
+    , _next_slot{o._next_slot}
+    , _pending_count{o._pending_count}
+{
+    o._slots.clear();
+    o._pending_count = 0;
+}
+
+auto PixelReadback::operator=(PixelReadback&& o) noexcept -> PixelReadback&
+{
+    if (&o != this)
+    {
+        for (auto& slot : _slots)
+            glDeleteSync(slot.fence);
+        _slots           = std::move(o._slots);
+        _next_slot       = o._next_slot;
+        _pending_count   = o._pending_count;
+        o._slots.clear();
+        o._pending_count = 0;
+    }
+    return *this;
+}
+
+auto PixelReadback::request(GLuint framebuffer, GLenum attachment, GLsizei width, GLsizei height) -> std::optional<ReadPixels>
+{
+    std::optional<ReadPixels> oldest_pixels{};
+    if (_pending_count == _slots.size())
+        oldest_pixels = get(); // All the buffers are in flight
+
+    auto&            slot = _slots[_next_slot];
+    GLsizeiptr const size = static_cast<GLsizeiptr>(width) * height * 4;
+
+    GLuint const previous_read_framebuffer = internal::framebuffer_state().read_framebuffer;
+    internal::bind_read_framebuffer(framebuffer);
+    glReadBuffer(attachment);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer.id());
+    if (slot.capacity != size)
+    {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.capacity = size;
+    }
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr); // Returns immediately because the destination is a buffer
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    internal::bind_read_framebuffer(previous_read_framebuffer);
+
+    slot.fence  = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width  = width;
+    slot.height = height;
+    glFlush(); // Makes sure the fence gets to the GPU, otherwise try_get() could keep waiting for it
+
+    _next_slot = (_next_slot + 1) % _slots.size();
+    _pending_count++;
+    return oldest_pixels;
+}
+
+auto PixelReadback::try_get(ReadPixels& destination) -> bool
+{
+    if (_pending_count == 0)
+        return false;
+    GLenum const status = glClientWaitSync(oldest_slot().fence, 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return false;
+    map_oldest(destination);
+    return true;
+}
+
+auto PixelReadback::get(ReadPixels& destination) -> bool
+{
+    if (_pending_count == 0)
+        return false;
+    GLenum const status = glClientWaitSync(oldest_slot().fence, GL_SYNC_FLUSH_COMMANDS_BIT, std::numeric_limits<GLuint64>::max());
+    if (status == GL_WAIT_FAILED)
+        handle_error("[PixelReadback] Failed to wait for the GPU");
+    map_oldest(destination);
+    return true;
+}
+
+auto PixelReadback::try_get() -> std::optional<ReadPixels>
+{
+    ReadPixels pixels{};
+    if (!try_get(pixels))
+        return std::nullopt;
+    return pixels;
+}
+
+auto PixelReadback::get() -> std::optional<ReadPixels>
+{
+    ReadPixels pixels{};
+    if (!get(pixels))
+        return std::nullopt;
+    return pixels;
+}
+
+void PixelReadback::map_oldest(ReadPixels& destination)
+{
+    auto& slot = oldest_slot();
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    _pending_count--;
+
+    destination.width  = slot.width;
+    destination.height = slot.height;
+    destination.data.resize(static_cast<size_t>(slot.capacity));
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer.id());
+    void const* const mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot.capacity, GL_MAP_READ_BIT);
+    if (!mapped)
+    {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        handle_error("[PixelReadback] Failed to map the pixel buffer");
+    }
+    std::memcpy(destination.data.data(), mapped, destination.data.size());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+} // namespace gl
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+#include "UniqueBuffer.hpp"
+#include "glad/gl.h"
+
+namespace gl {
+
+/// Pixels copied back from the GPU, as RGBA with 8 bits per channel.
+/// The first row is the bottom of the image (OpenGL convention), so save them with flip_vertically = true.
+struct ReadPixels {
+    GLsizei              width{};
+    GLsizei              height{};
+    std::vector<uint8_t> data{};
+};
+
+/// Copies framebuffers to the CPU without stalling the GPU: the copy goes into a pixel buffer object,
+/// and is only mapped once a fence tells us the GPU is done with it, typically one or two frames later.
+class PixelReadback {
+public:
+    /// buffers_count is the number of copies that can be in flight at the same time
+    explicit PixelReadback(size_t buffers_count = 3);
+    ~PixelReadback();
+    PixelReadback(PixelReadback const&)                    = delete; // You cannot copy
+    auto operator=(PixelReadback const&) -> PixelReadback& = delete; // a PixelReadback. But you can move it, using std::move(my_readback)
+    PixelReadback(PixelReadback&&) noexcept;
+    auto operator=(PixelReadback&&) noexcept -> PixelReadback&;
+
+    /// Starts copying the given attachment of the framebuffer. If all the buffers are still in flight, waits for the oldest one first and returns its pixels.
+    auto request(GLuint framebuffer, GLenum attachment, GLsizei width, GLsizei height) -> std::optional<ReadPixels>;
+    /// Returns the pixels of the oldest copy if the GPU has finished it, without blocking
+    auto try_get() -> std::optional<ReadPixels>;
+    /// Returns the pixels of the oldest copy, waiting for the GPU if needed. Returns nothing if there is no copy in flight.
+    auto get() -> std::optional<ReadPixels>;
+
+    /// Same as try_get() and get(), but write into destination, reusing its memory. Return false if there were no pixels to read.
+    auto try_get(ReadPixels& destination) -> bool;
+    auto get(ReadPixels& destination) -> bool;
+
+    auto pending_count() const -> size_t { return _pending_count; }
+    auto buffers_count() const -> size_t { return _slots.size(); }
+
+private:
+    struct Slot {
+        internal::UniqueBuffer buffer{};
+        GLsizeiptr             capacity{0};
+        GLsync                 fence{nullptr};
+        GLsizei                width{};
+        GLsizei                height{};
+    };
+
+    auto oldest_slot() -> Slot& { return _slots[(_next_slot + _slots.size() - _pending_count) % _slots.size()]; }
+    void map_oldest(ReadPixels& destination);
+
+private:
+    std::vector<Slot> _slots{};
+    size_t            _next_slot{0};
+    size_t            _pending_count{0};
+};
+
+} // namespace gl
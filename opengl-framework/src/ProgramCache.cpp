@@ -0,0 +1,130 @@
+#include "ProgramCache.hpp"
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+#include <vector>
+#include "exe_path/exe_path.h"
+
+namespace gl::internal {
+
+static constexpr auto file_magic = std::array<char, 8>{'G', 'L', 'P', 'R', 'O', 'G', '0', '1'};
+
+static auto cache_folder() -> std::filesystem::path
+{
+    return exe_path::dir() / "shader_cache";
+}
+
+static auto gl_string(GLenum name) -> std::string
+{
+    auto const* const str = glGetString(name);
+    return str != nullptr ? reinterpret_cast<char const*>(str) : ""; // NOLINT(*reinterpret-cast)
+}
+
+// FNV-1a
+static auto hash(std::string_view data, uint64_t seed = 14695981039346656037ull) -> uint64_t
+{
+    uint64_t h = seed;
+    for (char const c : data)
+    {
+        h ^= static_cast<uint8_t>(c);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+auto ProgramCache::instance() -> ProgramCache&
+{
+    static auto instance = ProgramCache{};
+    return instance;
+}
+
+ProgramCache::ProgramCache()
+{
+    GLint formats_count{0};
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats_count);
+    _is_enabled = formats_count > 0;
+    _driver     = std::format("{}\n{}\n{}", gl_string(GL_VENDOR), gl_string(GL_RENDERER), gl_string(GL_VERSION));
+}
+
+auto ProgramCache::key(std::string_view vertex_code, std::string_view fragment_code) const -> std::string
+{
+    // Two different seeds give a 128 bits key, so that collisions are not something we need to worry about
+    uint64_t a = hash(_driver);
+    uint64_t b = hash(_driver, 0x9E3779B97F4A7C15ull);
+    for (auto const code : {vertex_code, std::string_view{"\0", 1}, fragment_code})
+    {
+        a = hash(code, a);
+        b = hash(code, b);
+    }
+    return std::format("{:016x}{:016x}", a, b);
+}
+
+auto ProgramCache::load(GLuint program, std::string const& key) const -> bool
+{
+    if (!_is_enabled)
+        return false;
+    auto file = std::ifstream{cache_folder() / (key + ".bin"), std::ios::binary};
+    if (!file)
+        return false;
+
+    auto   magic  = std::array<char, 8>{};
+    GLenum format = 0;
+    file.read(magic.data(), magic.size());
+    file.read(reinterpret_cast<char*>(&format), sizeof(format)); // NOLINT(*reinterpret-cast)
+    if (!file || magic != file_magic)
+        return false;
+    auto const binary = std::vector<char>{std::istreambuf_iterator<char>{file}, {}};
+    if (binary.empty())
+        return false;
+
+    glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint is_linked{GL_FALSE};
+    glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+    return is_linked == GL_TRUE; // The driver can reject a binary, e.g. if it has been updated without changing its version string
+}
+
+void ProgramCache::save(GLuint program, std::string const& key) const
+{
+    if (!_is_enabled)
+        return;
+    GLint length{0};
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+    auto   binary = std::vector<char>(static_cast<size_t>(length));
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    auto error = std::error_code{};
+    std::filesystem::create_directories(cache_folder(), error);
+    // Written under a temporary name then renamed, so that a crash can never leave a half-written entry
+    auto const path      = cache_folder() / (key + ".bin");
+    auto const temp_path = cache_folder() / (key + ".tmp");
+    {
+        auto file = std::ofstream{temp_path, std::ios::binary | std::ios::trunc};
+        file.write(file_magic.data(), file_magic.size());
+        file.write(reinterpret_cast<char const*>(&format), sizeof(format)); // NOLINT(*reinterpret-cast)
+        file.write(binary.data(), static_cast<std::streamsize>(binary.size()));
+        if (!file)
+        {
+            std::cerr << std::format("[ProgramCache] Failed to write \"{}\", the shader will be compiled again next time\n", temp_path.string());
+            return;
+        }
+    }
+    std::filesystem::rename(temp_path, path, error);
+}
+
+void ProgramCache::remove(std::string const& key) const
+{
+    if (!_is_enabled)
+        return;
+    auto error = std::error_code{};
+    std::filesystem::remove(cache_folder() / (key + ".bin"), error); // Nothing to do if it has never been written
+}
+
+} // namespace gl::internal
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include "glad/gl.h"
+
+namespace gl::internal {
+
+/// Stores linked programs on disk, in a "shader_cache" folder next to the executable, so that the next launches don't have to compile the GLSL again.
+/// Entries are keyed on the source code and on the driver, so updating either one simply misses the cache.
+class ProgramCache {
+public:
+    static auto instance() -> ProgramCache&;
+
+    auto key(std::string_view vertex_code, std::string_view fragment_code) const -> std::string;
+    /// Returns false if there is no entry for this key, or if the driver rejects it, in which case the program must be compiled from source.
+    auto load(GLuint program, std::string const& key) const -> bool;
+    /// The program must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set. Failing to write the file is not an error, the program will just be compiled again next time.
+    void save(GLuint program, std::string const& key) const;
+    /// Deletes the entry, e.g. once a shader has been edited and its old code will never be used again
+    void remove(std::string const& key) const;
+
+    auto is_enabled() const -> bool { return _is_enabled; }
+
+private:
+    ProgramCache();
+
+private:
+    bool        _is_enabled{false}; // False if the driver doesn't support any binary format
+    std::string _driver{};         // Vendor, renderer and version
+};
+
+} // namespace gl::internal
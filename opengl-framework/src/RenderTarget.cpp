@@ -1,5 +1,4 @@
 #include "RenderTarget.hpp"
-#include <array>
 #include "Texture.hpp"
 #include "handle_error.hpp"
 
@@ -95,34 +94,35 @@ RenderTarget::RenderTarget(RenderTarget_Descriptor const& desc)
     create_attachments(desc);
 }
 
-void RenderTarget::render(std::function<void()> const& render_fn)
+void RenderTarget::resize(int width, int height)
 {
-    // Store previous state to restore it at the end
-    int                previous_draw_framebuffer{};
-    int                previous_read_framebuffer{};
-    std::array<int, 4> previous_viewport{};
-    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previous_draw_framebuffer);
-    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous_read_framebuffer);
-    glGetIntegerv(GL_VIEWPORT, previous_viewport.data());
-
-    // Bind our framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, _id.id());
-    glViewport(0, 0, _desc.width, _desc.height);
+    if (width == _desc.width && height == _desc.height)
+        return; // Nothing to reallocate, and the content is kept
+    _desc.width  = width;
+    _desc.height = height;
+    create_attachments(_desc);
+}
 
-    // Render
-    render_fn();
+auto RenderTarget::read_pixels_async(size_t color_texture_index) -> std::optional<ReadPixels>
+{
+    assert(color_texture_index < _color_textures.size());
+    if (!_readback.has_value())
+        _readback.emplace();
 
-    // Re-bind previous framebuffer
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previous_draw_framebuffer);
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, previous_read_framebuffer);
-    glViewport(previous_viewport[0], previous_viewport[1], previous_viewport[2], previous_viewport[3]);
+    // Take the finished copy before starting a new one, so that the new one never has to wait for a buffer to be available
+    auto pixels = _readback->try_get();
+    auto oldest = _readback->request(_id.id(), GL_COLOR_ATTACHMENT0 + static_cast<GLenum>(color_texture_index), _desc.width, _desc.height);
+    return pixels.has_value() ? std::move(pixels) : std::move(oldest);
 }
 
-void RenderTarget::resize(int width, int height)
+auto RenderTarget::flush_pixels() -> std::vector<ReadPixels>
 {
-    _desc.width  = width;
-    _desc.height = height;
-    create_attachments(_desc);
+    std::vector<ReadPixels> result{};
+    if (!_readback.has_value())
+        return result;
+    while (auto pixels = _readback->get())
+        result.push_back(std::move(*pixels));
+    return result;
 }
 
 } // namespace gl
\ No newline at end of file
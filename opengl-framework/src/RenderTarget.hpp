@@ -1,5 +1,8 @@
 #pragma once
-#include <functional>
+#include <optional>
+#include <utility>
+#include "FramebufferState.hpp"
+#include "PixelReadback.hpp"
 #include "Texture.hpp"
 #include "glad/gl.h"
 
@@ -62,9 +65,32 @@ class RenderTarget {
 public:
     explicit RenderTarget(RenderTarget_Descriptor const&);
 
-    void render(std::function<void()> const& render_fn);
+    /// Calls render_fn with this RenderTarget bound as the framebuffer (and the viewport set to its size), then binds back the previous framebuffer and viewport
+    template<typename RenderFn>
+    void render(RenderFn&& render_fn)
+    {
+        auto const previous_state = internal::framebuffer_state();
+        internal::set_framebuffer_state({
+            .draw_framebuffer = _id.id(),
+            .read_framebuffer = _id.id(),
+            .viewport_width   = _desc.width,
+            .viewport_height  = _desc.height,
+        });
+        std::forward<RenderFn>(render_fn)();
+        internal::set_framebuffer_state(previous_state);
+    }
+    /// Recreates all the attachments (and clears them), unless the size didn't change in which case this does nothing
     void resize(GLsizei width, GLsizei height);
 
+    auto width() const -> GLsizei { return _desc.width; }
+    auto height() const -> GLsizei { return _desc.height; }
+
+    /// Starts copying a color texture to the CPU, and returns the pixels of a previous call once the GPU is done with them (usually one or two frames later).
+    /// This never waits for the GPU, unless more than 3 copies are in flight. Call flush_pixels() at the end to get the copies that are still in flight.
+    auto read_pixels_async(size_t color_texture_index = 0) -> std::optional<ReadPixels>;
+    /// Waits for all the copies started by read_pixels_async() and returns their pixels, oldest first
+    auto flush_pixels() -> std::vector<ReadPixels>;
+
     auto color_texture(size_t index) const -> Texture const& { return _color_textures.at(index); }
     auto depth_stencil_texture() const -> Texture const&
     {
@@ -76,9 +102,10 @@ private:
     void create_attachments(RenderTarget_Descriptor const& desc);
 
 private:
-    internal::UniqueFramebuffer _id{};
-    std::vector<Texture>        _color_textures{};
-    std::optional<Texture>      _depth_stencil_texture{};
+    internal::UniqueFramebuffer  _id{};
+    std::vector<Texture>         _color_textures{};
+    std::optional<Texture>       _depth_stencil_texture{};
+    std::optional<PixelReadback> _readback{}; // Only created when reading pixels for the first time
 
     RenderTarget_Descriptor _desc{};
 };
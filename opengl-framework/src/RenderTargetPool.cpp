@@ -0,0 +1,44 @@
+#include "RenderTargetPool.hpp"
+#include <algorithm>
+#include <cassert>
+
+namespace gl {
+
+auto RenderTargetPool::acquire(GLsizei width, GLsizei height, InternalFormat_Color format) -> RenderTarget&
+{
+    auto it = std::find_if(_targets.begin(), _targets.end(), [&](Entry const& entry) {
+        return !entry.is_acquired && entry.format == format && entry.target->width() == width && entry.target->height() == height;
+    });
+    if (it == _targets.end())
+    {
+        _targets.push_back(Entry{
+            .target = std::make_unique<RenderTarget>(RenderTarget_Descriptor{
+                .width          = width,
+                .height         = height,
+                .color_textures = {ColorAttachment_Descriptor{.format = format}},
+            }),
+            .format = format,
+        });
+        it = std::prev(_targets.end());
+    }
+    it->is_acquired     = true;
+    it->last_used_frame = _frame;
+    return *it->target;
+}
+
+void RenderTargetPool::release(RenderTarget const& target)
+{
+    auto const it = std::find_if(_targets.begin(), _targets.end(), [&](Entry const& entry) { return entry.target.get() == &target; });
+    assert(it != _targets.end() && it->is_acquired && "This target doesn't come from this pool, or has already been released.");
+    it->is_acquired = false;
+}
+
+void RenderTargetPool::collect_garbage(uint32_t max_unused_frames)
+{
+    _frame++;
+    std::erase_if(_targets, [&](Entry const& entry) {
+        return !entry.is_acquired && _frame - entry.last_used_frame > max_unused_frames;
+    });
+}
+
+} // namespace gl
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "RenderTarget.hpp"
+
+namespace gl {
+
+/// Reuses RenderTargets across the passes of a frame and across frames, instead of creating new ones for each effect.
+/// Usage: acquire() a target when a pass needs one, release() it as soon as the passes that read it are done, and call collect_garbage() once per frame.
+class RenderTargetPool {
+public:
+    /// Returns a target with a single color attachment that nobody else has acquired. Its content is whatever the last user left in it.
+    /// The reference stays valid until collect_garbage() destroys the target, which never happens while it is acquired.
+    auto acquire(GLsizei width, GLsizei height, InternalFormat_Color format = InternalFormat_Color::RGBA16F) -> RenderTarget&;
+    void release(RenderTarget const&);
+
+    /// Destroys the targets that haven't been acquired during the last max_unused_frames calls to collect_garbage(), e.g. the ones with the old size after the window has been resized
+    void collect_garbage(uint32_t max_unused_frames = 3);
+
+    /// Number of targets currently allocated, acquired or not
+    auto size() const -> size_t { return _targets.size(); }
+
+private:
+    struct Entry {
+        std::unique_ptr<RenderTarget> target; // Pointer so that references don't get invalidated when the vector grows
+        InternalFormat_Color          format;
+        bool                          is_acquired{false};
+        uint64_t                      last_used_frame{0};
+    };
+    std::vector<Entry> _targets{};
+    uint64_t           _frame{0};
+};
+
+} // namespace gl
@@ -0,0 +1,32 @@
+#include "Sampler.hpp"
+#include <algorithm>
+#include "glm/gtc/type_ptr.hpp"
+
+namespace gl {
+
+auto SamplerLibrary::instance() -> SamplerLibrary&
+{
+    static auto instance = SamplerLibrary{};
+    return instance;
+}
+
+auto SamplerLibrary::get(TextureOptions const& options) -> GLuint
+{
+    auto const it = std::find_if(_samplers.begin(), _samplers.end(), [&](auto const& sampler) { return sampler.first == options; });
+    if (it != _samplers.end())
+        return it->second.id();
+
+    auto       sampler = internal::UniqueSampler{};
+    auto const id      = sampler.id();
+    glSamplerParameteri(id, GL_TEXTURE_MIN_FILTER, static_cast<GLint>(options.minification_filter));
+    glSamplerParameteri(id, GL_TEXTURE_MAG_FILTER, static_cast<GLint>(options.magnification_filter));
+    glSamplerParameteri(id, GL_TEXTURE_WRAP_S, static_cast<GLint>(options.wrap_x));
+    glSamplerParameteri(id, GL_TEXTURE_WRAP_T, static_cast<GLint>(options.wrap_y));
+    glSamplerParameterfv(id, GL_TEXTURE_BORDER_COLOR, glm::value_ptr(options.border_color));
+    if (internal::max_supported_anisotropy() > 1.f)
+        glSamplerParameterf(id, internal::texture_max_anisotropy, std::clamp(options.max_anisotropy, 1.f, internal::max_supported_anisotropy()));
+    _samplers.emplace_back(options, std::move(sampler));
+    return id;
+}
+
+} // namespace gl
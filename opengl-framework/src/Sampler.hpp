@@ -0,0 +1,61 @@
+#pragma once
+#include <utility>
+#include <vector>
+#include "Texture.hpp"
+#include "glad/gl.h"
+
+namespace gl {
+
+namespace internal {
+class UniqueSampler {
+public:
+    UniqueSampler() // NOLINT(*-member-init)
+    {
+        glGenSamplers(1, &_id);
+    }
+    ~UniqueSampler()
+    {
+        glDeleteSamplers(1, &_id);
+    }
+    UniqueSampler(UniqueSampler const&)                    = delete; // You cannot copy
+    auto operator=(UniqueSampler const&) -> UniqueSampler& = delete; // a sampler. But you can move it, using std::move(my_sampler)
+    UniqueSampler(UniqueSampler&& o) noexcept
+        : _id{o._id}
+    {
+        o._id = 0;
+    }
+    auto operator=(UniqueSampler&& o) noexcept -> UniqueSampler&
+    {
+        if (&o != this)
+        {
+            glDeleteSamplers(1, &_id);
+            _id   = o._id;
+            o._id = 0;
+        }
+        return *this;
+    }
+
+    auto id() const { return _id; }
+
+private:
+    GLuint _id;
+};
+} // namespace internal
+
+/// Sampler objects override the filtering and wrapping options of the texture they are used with, so that the same texture can be sampled in different ways.
+/// There is only one sampler object per set of options, shared by everyone.
+class SamplerLibrary {
+public:
+    static auto instance() -> SamplerLibrary&;
+
+    /// Creates the sampler the first time these options are asked for
+    auto get(TextureOptions const&) -> GLuint;
+
+private:
+    SamplerLibrary() = default;
+
+private:
+    std::vector<std::pair<TextureOptions, internal::UniqueSampler>> _samplers{}; // There are only a handful of them, a linear search is the fastest
+};
+
+} // namespace gl
@@ -1,32 +1,38 @@
 #include "Shader.hpp"
 #include <cassert>
 #include <fstream>
+#include "ProgramCache.hpp"
+#include "Sampler.hpp"
 #include "Texture.hpp"
+#include "TextureUnits.hpp"
+#include "glfw.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "handle_error.hpp"
+#include "has_extension.hpp"
 #include "make_absolute_path.hpp"
 
 namespace {
 
-void compile_shader_module(GLuint id, std::string const& source_code)
+void start_compiling_shader_module(GLuint id, std::string const& source_code)
 {
     char const* src = source_code.c_str();
     glShaderSource(id, 1, &src, nullptr);
     glCompileShader(id);
+}
 
-    { // Check for errors
-        int result;
-        glGetShaderiv(id, GL_COMPILE_STATUS, &result);
-        if (result)
-            return; // Compilation successful
+void check_for_compilation_errors(GLuint id, std::string const& source_code)
+{
+    int result;
+    glGetShaderiv(id, GL_COMPILE_STATUS, &result);
+    if (result)
+        return; // Compilation successful
 
-        GLsizei length;
-        glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
-        std::vector<GLchar> error_message;
-        error_message.resize(static_cast<size_t>(length));
-        glGetShaderInfoLog(id, length, nullptr, error_message.data());
-        gl::handle_error(std::format("Shader Compilation failed:\n{}\n\nThe code we tried to compile was:\n{}", error_message.data(), source_code));
-    }
+    GLsizei length;
+    glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
+    std::vector<GLchar> error_message;
+    error_message.resize(static_cast<size_t>(length));
+    glGetShaderInfoLog(id, length, nullptr, error_message.data());
+    gl::handle_error(std::format("Shader Compilation failed:\n{}\n\nThe code we tried to compile was:\n{}", error_message.data(), source_code));
 }
 
 auto get_source_code(gl::ShaderSource::Code const& source) -> std::string
@@ -39,41 +45,6 @@ auto get_source_code(gl::ShaderSource::File const& source) -> std::string
     return std::string{std::istreambuf_iterator<char>{ifs}, {}};
 }
 
-class UniqueShaderModule {
-public:
-    explicit UniqueShaderModule(GLenum shader_kind, gl::AnyShaderSource const& source)
-        : _id{glCreateShader(shader_kind)}
-    {
-        compile_shader_module(_id, std::visit([](auto&& source) { return get_source_code(source); }, source));
-    }
-    ~UniqueShaderModule()
-    {
-        glDeleteShader(_id);
-    }
-    UniqueShaderModule(UniqueShaderModule const&)                    = delete;
-    auto operator=(UniqueShaderModule const&) -> UniqueShaderModule& = delete;
-    UniqueShaderModule(UniqueShaderModule&& o) noexcept
-        : _id{o._id}
-    {
-        o._id = 0;
-    }
-    auto operator=(UniqueShaderModule&& o) noexcept -> UniqueShaderModule&
-    {
-        if (&o != this)
-        {
-            glDeleteShader(_id);
-            _id   = o._id;
-            o._id = 0;
-        }
-        return *this;
-    }
-
-    auto id() const { return _id; }
-
-private:
-    GLuint _id;
-};
-
 void check_for_linking_errors(GLuint shader_id)
 {
     int result;
@@ -93,16 +64,102 @@ void check_for_linking_errors(GLuint shader_id)
 
 namespace gl {
 
+// GL_KHR_parallel_shader_compile (or its ARB twin) isn't part of the functions loaded by glad, so we load it ourselves
+static constexpr GLenum completion_status = 0x91B1; // GL_COMPLETION_STATUS_KHR
+
+static auto has_parallel_shader_compile() -> bool
+{
+    static bool const instance = []() {
+        using MaxShaderCompilerThreads = void(GLAD_API_PTR*)(GLuint);
+        auto const* const function_name = has_extension("GL_KHR_parallel_shader_compile")   ? "glMaxShaderCompilerThreadsKHR"
+                                          : has_extension("GL_ARB_parallel_shader_compile") ? "glMaxShaderCompilerThreadsARB"
+                                                                                            : nullptr;
+        if (function_name == nullptr)
+            return false;
+        auto const max_shader_compiler_threads = reinterpret_cast<MaxShaderCompilerThreads>(glfwGetProcAddress(function_name)); // NOLINT(*reinterpret-cast)
+        if (max_shader_compiler_threads != nullptr)
+            max_shader_compiler_threads(0xFFFFFFFF); // Let the driver use as many threads as it wants
+        return true;
+    }();
+    return instance;
+}
+
 Shader::Shader(Shader_Descriptor const& desc)
 {
-    auto vertex_shader   = UniqueShaderModule{GL_VERTEX_SHADER, desc.vertex};
-    auto fragment_shader = UniqueShaderModule{GL_FRAGMENT_SHADER, desc.fragment};
-    glAttachShader(id(), vertex_shader.id());
-    glAttachShader(id(), fragment_shader.id());
+    auto build = start_build(desc);
+    finish_build(build);
+}
+
+auto Shader::start_build(Shader_Descriptor const& desc) -> internal::ShaderBuild
+{
+    auto build = internal::ShaderBuild{
+        .vertex_code   = std::visit([](auto&& source) { return get_source_code(source); }, desc.vertex),
+        .fragment_code = std::visit([](auto&& source) { return get_source_code(source); }, desc.fragment),
+    };
+
+    auto const& cache = internal::ProgramCache::instance();
+    build.cache_key   = cache.key(build.vertex_code, build.fragment_code);
+    _cache_key        = build.cache_key;
+    if (cache.load(id(), build.cache_key))
+        return build;
+
+    build.vertex_shader.emplace(GL_VERTEX_SHADER);
+    build.fragment_shader.emplace(GL_FRAGMENT_SHADER);
+    start_compiling_shader_module(build.vertex_shader->id(), build.vertex_code);
+    start_compiling_shader_module(build.fragment_shader->id(), build.fragment_code);
+    glAttachShader(id(), build.vertex_shader->id());
+    glAttachShader(id(), build.fragment_shader->id());
+    if (cache.is_enabled())
+        glProgramParameteri(id(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(id());
-    glDetachShader(id(), fragment_shader.id());
-    glDetachShader(id(), vertex_shader.id());
+    return build;
+}
+
+void Shader::finish_build(internal::ShaderBuild& build)
+{
+    if (!build.vertex_shader.has_value())
+        return; // Loaded from the cache, it has already been checked
+
+    check_for_compilation_errors(build.vertex_shader->id(), build.vertex_code);
+    check_for_compilation_errors(build.fragment_shader->id(), build.fragment_code);
+    glDetachShader(id(), build.fragment_shader->id());
+    glDetachShader(id(), build.vertex_shader->id());
     check_for_linking_errors(id());
+    internal::ProgramCache::instance().save(id(), build.cache_key);
+    build.vertex_shader.reset();
+    build.fragment_shader.reset();
+}
+
+AsyncShader::AsyncShader(Shader_Descriptor const& desc)
+{
+    std::ignore = has_parallel_shader_compile(); // Must be enabled before the compilation starts
+    _build      = _shader.start_build(desc);
+}
+
+auto AsyncShader::is_ready() const -> bool
+{
+    if (!_build.has_value() || !_build->vertex_shader.has_value() || !has_parallel_shader_compile())
+        return true;
+    GLint is_completed{GL_FALSE};
+    glGetProgramiv(_shader.id(), completion_status, &is_completed);
+    return is_completed == GL_TRUE;
+}
+
+auto AsyncShader::get() -> Shader const&
+{
+    if (_build.has_value())
+    {
+        auto build = std::move(*_build);
+        _build.reset(); // Before checking, so that we only report an error once
+        _shader.finish_build(build);
+    }
+    return _shader;
+}
+
+auto AsyncShader::take() -> Shader
+{
+    std::ignore = get();
+    return std::move(_shader);
 }
 
 static void assert_shader_is_bound(GLuint id)
@@ -123,16 +180,16 @@ void Shader::bind() const
 
 auto Shader::uniform_location(std::string_view uniform_name) const -> GLint
 {
-    auto const name = std::string{uniform_name};
-    auto const it   = _uniform_locations.find(name);
+    auto const it = _uniform_locations.find(uniform_name);
     if (it != _uniform_locations.end())
     {
         return it->second;
     }
     else
     {
+        auto        name         = std::string{uniform_name}; // Only allocates the first time, we need a null-terminated string for OpenGL
         GLint const location     = glGetUniformLocation(id(), name.c_str());
-        _uniform_locations[name] = location;
+        _uniform_locations.emplace(std::move(name), location);
         return location;
     }
 }
@@ -201,41 +258,22 @@ void Shader::set_uniform(std::string_view uniform_name, const glm::mat4& mat) co
     glUniformMatrix4fv(uniform_location(uniform_name), 1, GL_FALSE, glm::value_ptr(mat));
 }
 
-static auto max_number_of_texture_slots() -> GLuint
+void Shader::set_uniform(std::string_view uniform_name, Texture const& texture) const
 {
-    GLint res{};
-    glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &res);
-    return static_cast<GLuint>(res);
+    // Textures that are already bound keep their unit, so this is usually just the glUniform1i() call
+    set_uniform(uniform_name, internal::TextureUnits::instance().bind(texture.id()));
 }
 
-static auto get_next_texture_slot() -> GLuint
+void Shader::set_uniform_bindless(std::string_view uniform_name, Texture const& texture) const
 {
-    static GLuint       current_slot = 0;
-    static GLuint const max_slots    = max_number_of_texture_slots();
-
-    current_slot = (current_slot + 1) % max_slots;
-    if (current_slot == 0) // HACK Slot 0 is used for texture operations like resizing and setting the image, anyone might override the texture set here at any time. So we use all slots but the 0th one for rendering.
-        current_slot = 1;
-    return current_slot;
+    assert_shader_is_bound(id());
+    if (!internal::TextureUnits::instance().set_bindless_uniform(uniform_location(uniform_name), texture.id()))
+        set_uniform(uniform_name, texture);
 }
 
-void Shader::set_uniform(std::string_view uniform_name, Texture const& texture) const
+void Shader::set_uniform(std::string_view uniform_name, Texture const& texture, TextureOptions const& sampler) const
 {
-    auto const slot = get_next_texture_slot();
-    glActiveTexture(GL_TEXTURE0 + slot);
-    glBindTexture(GL_TEXTURE_2D, texture.id());
-    set_uniform(uniform_name, slot);
-    glActiveTexture(GL_TEXTURE0); // HACK Slot 0 is used for texture operations like resizing and setting the image, anyone might override the texture set here at any time. So we use all slots but the 0th one for rendering.
-}
-
-// void Shader::set_uniform_texture(std::string_view uniform_name, GLuint texture_id, TextureSamplerDescriptor const& sampler) const
-// {
-//     auto const slot = get_next_texture_slot();
-//     glActiveTexture(GL_TEXTURE0 + slot);
-//     glBindTexture(GL_TEXTURE_2D, texture_id);
-//     glBindSampler(slot, TextureSamplerLibrary::instance().get(sampler).id()));
-//     set_uniform(uniform_name, static_cast<int>(slot));
-//     glActiveTexture(GL_TEXTURE0); // HACK Slot 0 is used for texture operations like resizing and setting the image, anyone might override the texture set here at any time. So we use all slots but the 0th one for rendering.
-// }
+    set_uniform(uniform_name, internal::TextureUnits::instance().bind(texture.id(), SamplerLibrary::instance().get(sampler)));
+}
 
 } // namespace gl
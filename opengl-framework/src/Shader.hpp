@@ -1,5 +1,7 @@
 #pragma once
 #include <filesystem>
+#include <functional>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -43,6 +45,54 @@ public:
 private:
     GLuint _id;
 };
+
+class UniqueShaderModule {
+public:
+    explicit UniqueShaderModule(GLenum shader_kind)
+        : _id{glCreateShader(shader_kind)}
+    {}
+    ~UniqueShaderModule()
+    {
+        glDeleteShader(_id);
+    }
+    UniqueShaderModule(UniqueShaderModule const&)                    = delete;
+    auto operator=(UniqueShaderModule const&) -> UniqueShaderModule& = delete;
+    UniqueShaderModule(UniqueShaderModule&& o) noexcept
+        : _id{o._id}
+    {
+        o._id = 0;
+    }
+    auto operator=(UniqueShaderModule&& o) noexcept -> UniqueShaderModule&
+    {
+        if (&o != this)
+        {
+            glDeleteShader(_id);
+            _id   = o._id;
+            o._id = 0;
+        }
+        return *this;
+    }
+
+    auto id() const { return _id; }
+
+private:
+    GLuint _id;
+};
+
+/// What is needed to check the result of a compilation that has been started
+struct ShaderBuild {
+    std::string                       vertex_code{};
+    std::string                       fragment_code{};
+    std::string                       cache_key{};
+    std::optional<UniqueShaderModule> vertex_shader{};   // Empty when the program has been loaded from the cache
+    std::optional<UniqueShaderModule> fragment_shader{}; // Empty when the program has been loaded from the cache
+};
+/// Allows looking up a std::string key with a std::string_view, without having to create a std::string
+struct TransparentStringHash {
+    using is_transparent = void;
+    auto operator()(std::string_view str) const -> size_t { return std::hash<std::string_view>{}(str); }
+};
+
 } // namespace internal
 
 namespace ShaderSource {
@@ -84,13 +134,47 @@ public:
     void set_uniform(std::string_view uniform_name, glm::mat3 const&) const;
     void set_uniform(std::string_view uniform_name, glm::mat4 const&) const;
     void set_uniform(std::string_view uniform_name, Texture const&) const;
+    /// Samples the texture with the given options instead of the ones it was created with (see SamplerLibrary). The mipmap filters need the texture to have mipmaps.
+    void set_uniform(std::string_view uniform_name, Texture const&, TextureOptions const& sampler) const;
+    /// Uses GL_ARB_bindless_texture when it is available, so that the texture doesn't take a texture unit. Falls back to set_uniform() otherwise.
+    /// Your shader must contain `#extension GL_ARB_bindless_texture : enable`, and the texture can't be modified anymore afterwards.
+    void set_uniform_bindless(std::string_view uniform_name, Texture const&) const;
 
 private:
+    friend class AsyncShader;
+    friend class ShaderWatcher;
+    Shader() = default;
+    /// Sends the code to the driver, without asking for any result, so that the driver is free to compile in the background
+    auto start_build(Shader_Descriptor const&) -> internal::ShaderBuild;
+    /// Waits for the driver if it is still compiling, and throws if the compilation failed
+    void finish_build(internal::ShaderBuild&);
+
     auto uniform_location(std::string_view uniform_name) const -> GLint;
+    /// Name of the entry of the program in the ProgramCache
+    auto cache_key() const -> std::string const& { return _cache_key; }
 
 private:
     internal::UniqueShader                         _id{};
-    mutable std::unordered_map<std::string, GLint> _uniform_locations{};
+    std::string                                    _cache_key{};
+    mutable std::unordered_map<std::string, GLint, internal::TransparentStringHash, std::equal_to<>> _uniform_locations{};
+};
+
+/// Starts compiling a shader without waiting for the result, so that the driver can compile several shaders at the same time
+/// (on several threads when GL_KHR_parallel_shader_compile is available). Create all your AsyncShaders first, and only then call get() on them.
+class AsyncShader {
+public:
+    explicit AsyncShader(Shader_Descriptor const&);
+
+    /// Never waits when GL_KHR_parallel_shader_compile is available. Without it there is no way to know, so this always returns true, and get() might wait.
+    auto is_ready() const -> bool;
+    /// Waits for the compilation if needed. The first call throws if the compilation failed.
+    auto get() -> Shader const&;
+    /// Same as get(), but moves the shader out of this AsyncShader, which must not be used anymore afterwards
+    auto take() -> Shader;
+
+private:
+    Shader                               _shader{};
+    std::optional<internal::ShaderBuild> _build{}; // Empty once the result has been checked
 };
 
 } // namespace gl
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "ShaderWatcher.hpp"
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <format>
+#include <iostream>
+#include <system_error>
+#include "ProgramCache.hpp"
+#include "make_absolute_path.hpp"
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace gl {
+
+ShaderWatcher::ShaderWatcher()
+{
+#if defined(__linux__)
+    _inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (_inotify_fd < 0)
+        std::cerr << "[ShaderWatcher] inotify is not available, shaders won't be reloaded\n";
+#endif
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+#if defined(__linux__)
+    if (_inotify_fd >= 0)
+        close(_inotify_fd);
+#endif
+}
+
+static auto files_of(Shader_Descriptor const& desc) -> std::vector<std::filesystem::path>
+{
+    auto files = std::vector<std::filesystem::path>{};
+    for (auto const* source : {&desc.vertex, &desc.fragment})
+    {
+        if (auto const* file = std::get_if<ShaderSource::File>(source))
+            files.push_back(make_absolute_path(file->path).lexically_normal());
+    }
+    return files;
+}
+
+auto WatchedShader::shader() const -> Shader const&
+{
+    if (!_state->shader.has_value())
+    {
+        if (_state->error != nullptr)
+            std::rethrow_exception(_state->error); // Until the files are fixed, see ShaderWatcher::update()
+        try
+        {
+            _state->shader.emplace(_state->rebuild->take());
+        }
+        catch (...)
+        {
+            _state->error = std::current_exception(); // The error has been printed already, later calls only rethrow it
+        }
+        _state->rebuild.reset();
+        if (_state->error != nullptr)
+            std::rethrow_exception(_state->error);
+    }
+    return *_state->shader;
+}
+
+auto ShaderWatcher::watch(Shader_Descriptor const& desc) -> WatchedShader
+{
+    auto state = std::make_shared<internal::WatchedShaderState>(internal::WatchedShaderState{
+        .desc    = desc,
+        .rebuild = AsyncShader{desc},
+    });
+    auto files = files_of(desc);
+    for (auto const& file : files)
+        watch_file(file);
+    _entries.push_back(Entry{.state = state, .files = std::move(files)});
+    return WatchedShader{std::move(state)};
+}
+
+#if defined(__linux__)
+
+void ShaderWatcher::watch_file(std::filesystem::path const& file)
+{
+    if (_inotify_fd < 0)
+        return;
+    auto const folder = file.parent_path();
+    // Adding the same folder twice returns the same descriptor
+    int const watch_descriptor = inotify_add_watch(_inotify_fd, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (watch_descriptor < 0)
+    {
+        std::cerr << std::format("[ShaderWatcher] Can't watch \"{}\"\n", folder.string());
+        return;
+    }
+    _watched_folders[watch_descriptor] = folder;
+}
+
+auto ShaderWatcher::changed_files() -> std::unordered_set<std::filesystem::path>
+{
+    auto files = std::unordered_set<std::filesystem::path>{};
+    if (_inotify_fd < 0)
+        return files;
+
+    alignas(inotify_event) std::array<char, 4096> buffer{};
+    while (true)
+    {
+        auto const length = read(_inotify_fd, buffer.data(), buffer.size());
+        if (length <= 0) // EAGAIN once all the events have been read
+            break;
+        for (ssize_t offset = 0; offset < length;)
+        {
+            auto const* const event = reinterpret_cast<inotify_event const*>(buffer.data() + offset); // NOLINT(*reinterpret-cast)
+            auto const        folder = _watched_folders.find(event->wd);
+            if (event->len > 0 && folder != _watched_folders.end())
+                files.insert(folder->second / event->name);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+    return files;
+}
+
+#else
+
+void ShaderWatcher::watch_file(std::filesystem::path const& file)
+{
+    auto error              = std::error_code{};
+    _last_write_times[file] = std::filesystem::last_write_time(file, error);
+}
+
+auto ShaderWatcher::changed_files() -> std::unordered_set<std::filesystem::path>
+{
+    auto       files = std::unordered_set<std::filesystem::path>{};
+    auto const now   = std::chrono::steady_clock::now();
+    if (now < _next_check)
+        return files;
+    _next_check = now + std::chrono::milliseconds{300};
+
+    for (auto& [file, last_write_time] : _last_write_times)
+    {
+        auto       error      = std::error_code{};
+        auto const write_time = std::filesystem::last_write_time(file, error);
+        if (error || write_time == last_write_time)
+            continue;
+        last_write_time = write_time;
+        files.insert(file);
+    }
+    return files;
+}
+
+#endif
+
+void ShaderWatcher::update()
+{
+    std::erase_if(_entries, [](Entry const& entry) { return entry.state.expired(); });
+
+    auto const changed = changed_files();
+    for (auto const& entry : _entries)
+    {
+        auto const state = entry.state.lock();
+        if (!state->shader.has_value() && state->error == nullptr)
+            continue; // The first compilation is checked by WatchedShader::shader(). If it failed, we retry each time the files change.
+        if (!changed.empty() && std::any_of(entry.files.begin(), entry.files.end(), [&](auto const& file) { return changed.contains(file); }))
+        {
+            try
+            {
+                state->rebuild.emplace(state->desc); // Restarts from scratch if the previous rebuild wasn't done yet
+            }
+            catch (std::exception const&) // The file might be missing for a moment while the editor saves it. The error has been printed already.
+            {
+                state->rebuild.reset();
+            }
+        }
+
+        if (!state->rebuild.has_value() || !state->rebuild->is_ready())
+            continue;
+        try
+        {
+            auto shader = state->rebuild->take();
+            if (state->shader.has_value() && shader.cache_key() != state->shader->cache_key())
+                internal::ProgramCache::instance().remove(state->shader->cache_key());
+            state->shader = std::move(shader);
+            state->error  = nullptr;
+            std::cerr << std::format("[ShaderWatcher] Reloaded {}\n", entry.files.front().filename().string());
+        }
+        catch (std::exception const&) // Keep the previous shader. The error has been printed already.
+        {
+        }
+        state->rebuild.reset();
+    }
+}
+
+} // namespace gl
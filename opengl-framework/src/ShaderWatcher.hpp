@@ -0,0 +1,76 @@
+#pragma once
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Shader.hpp"
+
+namespace gl {
+
+namespace internal {
+struct WatchedShaderState {
+    std::optional<Shader>      shader{}; // Empty until the first compilation has been checked
+    Shader_Descriptor          desc;
+    std::optional<AsyncShader> rebuild{}; // Compiling in the background, replaces shader once it is done
+    std::exception_ptr         error{};   // Set if the first compilation failed, until a reload succeeds
+};
+} // namespace internal
+
+/// Shader returned by a ShaderWatcher. Get the shader every time you use it instead of keeping a reference, because it changes each time the files are reloaded.
+class WatchedShader {
+public:
+    /// The first call waits for the first compilation. If it failed, throws until the files are fixed and ShaderWatcher::update() reloads them.
+    auto shader() const -> Shader const&;
+
+private:
+    friend class ShaderWatcher;
+    explicit WatchedShader(std::shared_ptr<internal::WatchedShaderState> state)
+        : _state{std::move(state)}
+    {}
+
+private:
+    std::shared_ptr<internal::WatchedShaderState> _state;
+};
+
+/// Recompiles the shaders whose ShaderSource::File changed on disk, so that you can edit them without restarting.
+/// The new program is compiled in the background and only replaces the old one if it compiled successfully. On errors the old one is kept and the error is printed.
+/// The entry of the old program in the shader_cache folder is deleted, so that editing a shader doesn't fill the disk.
+/// Uses inotify on Linux, and checks the modification dates of the files a few times per second on other platforms.
+class ShaderWatcher {
+public:
+    ShaderWatcher();
+    ~ShaderWatcher();
+    ShaderWatcher(ShaderWatcher const&)                    = delete; // You cannot copy
+    auto operator=(ShaderWatcher const&) -> ShaderWatcher& = delete; // a ShaderWatcher
+
+    /// Starts compiling the shader in the background, like AsyncShader, so that several shaders can compile at the same time
+    [[nodiscard]] auto watch(Shader_Descriptor const&) -> WatchedShader;
+
+    /// Must be called once per frame, on the OpenGL thread
+    void update();
+
+private:
+    void watch_file(std::filesystem::path const& file);
+    auto changed_files() -> std::unordered_set<std::filesystem::path>;
+
+private:
+    struct Entry {
+        std::weak_ptr<internal::WatchedShaderState> state;
+        std::vector<std::filesystem::path>          files;
+    };
+    std::vector<Entry> _entries{};
+
+#if defined(__linux__)
+    int                                                 _inotify_fd{-1};
+    std::unordered_map<int, std::filesystem::path>      _watched_folders{}; // Watch descriptor -> folder. We watch folders because editors often save by replacing the file.
+#else
+    std::unordered_map<std::filesystem::path, std::filesystem::file_time_type> _last_write_times{};
+    std::chrono::steady_clock::time_point                                      _next_check{};
+#endif
+};
+
+} // namespace gl
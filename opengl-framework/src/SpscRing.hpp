@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace gl::internal {
+
+/// Fixed-size queue between exactly one producer thread and one consumer thread, without any lock.
+/// The elements are reused: the producer fills a slot in place then publishes it, the consumer reads it in place then releases it.
+template<typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : _slots(capacity)
+    {
+        assert(capacity > 0);
+    }
+
+    // ------ Producer thread ------
+
+    /// Waits until a slot is free and returns it. Call publish() once it is filled.
+    auto acquire_for_writing() -> T&
+    {
+        uint64_t const tail = _tail.load(std::memory_order_relaxed) & ~closed_bit;
+        while (true)
+        {
+            uint64_t const head = _head.load(std::memory_order_acquire);
+            if (tail - head < _slots.size())
+                break;
+            _head.wait(head, std::memory_order_acquire);
+        }
+        return _slots[tail % _slots.size()];
+    }
+    void publish()
+    {
+        _tail.fetch_add(1, std::memory_order_release);
+        _tail.notify_one();
+    }
+    /// Tells the consumer that nothing else will be published
+    void close()
+    {
+        _tail.fetch_or(closed_bit, std::memory_order_release);
+        _tail.notify_one();
+    }
+
+    // ------ Consumer thread ------
+
+    /// Waits until a slot is published and returns it, or returns nullptr once the ring is closed and empty. Call release() once it has been read.
+    auto acquire_for_reading() -> T*
+    {
+        uint64_t const head = _head.load(std::memory_order_relaxed);
+        while (true)
+        {
+            uint64_t const tail = _tail.load(std::memory_order_acquire);
+            if ((tail & ~closed_bit) != head)
+                return &_slots[head % _slots.size()];
+            if (tail & closed_bit)
+                return nullptr;
+            _tail.wait(tail, std::memory_order_acquire);
+        }
+    }
+    void release()
+    {
+        _head.fetch_add(1, std::memory_order_release);
+        _head.notify_one();
+    }
+
+private:
+    static constexpr uint64_t closed_bit = uint64_t{1} << 63;
+
+    std::vector<T>        _slots;
+    // On separate cache lines so that the two threads don't keep invalidating each other's cache
+    alignas(64) std::atomic<uint64_t> _head{0}; // Written by the consumer: number of slots released
+    alignas(64) std::atomic<uint64_t> _tail{0}; // Written by the producer: number of slots published, plus closed_bit
+};
+
+} // namespace gl::internal
@@ -1,6 +1,8 @@
 #include "Texture.hpp"
+#include <algorithm>
 #include <cassert>
 #include "glm/gtc/type_ptr.hpp"
+#include "has_extension.hpp"
 #include "img/img.hpp"
 #include "make_absolute_path.hpp"
 
@@ -11,9 +13,18 @@ static void upload_image_data(TextureSource::Pixels const& source)
     glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(source.texture_format), source.width, source.height, 0, static_cast<GLenum>(source.source_pixels_format), static_cast<GLenum>(source.source_pixels_type), source.pixels.data());
 }
 
+static auto full_mip_chain_levels(GLsizei width, GLsizei height) -> GLsizei
+{
+    GLsizei levels = 1;
+    for (GLsizei size = std::max(width, height); size > 1; size /= 2)
+        levels++;
+    return levels;
+}
+
 static void upload_image_data(TextureSource::EmptyImage const& source)
 {
-    glTexStorage2D(GL_TEXTURE_2D, 1, static_cast<GLint>(source.texture_format), source.width, source.height);
+    auto const levels = source.mip_levels == 0 ? full_mip_chain_levels(source.width, source.height) : source.mip_levels;
+    glTexStorage2D(GL_TEXTURE_2D, levels, static_cast<GLenum>(source.texture_format), source.width, source.height);
 }
 
 static void upload_image_data(TextureSource::File const& source)
@@ -22,15 +33,52 @@ static void upload_image_data(TextureSource::File const& source)
     upload_image_data(TextureSource::Pixels{.pixels = image.data_span(), .width = static_cast<GLsizei>(image.width()), .height = static_cast<GLsizei>(image.height()), .source_pixels_type = Type::UnsignedByte, .source_pixels_format = Format::RGBA, .texture_format = source.texture_format});
 }
 
-Texture::Texture(AnyTextureSource const& source, TextureOptions const& options)
+namespace internal {
+
+auto uses_mipmaps(Filter filter) -> bool
+{
+    return filter != Filter::NearestNeighbour && filter != Filter::Linear;
+}
+
+auto max_supported_anisotropy() -> float
+{
+    static float const instance = []() {
+        // Core since OpenGL 4.6 only, but the extension is available almost everywhere
+        if (!has_extension("GL_ARB_texture_filter_anisotropic") && !has_extension("GL_EXT_texture_filter_anisotropic"))
+            return 1.f;
+        float res{1.f};
+        glGetFloatv(max_texture_max_anisotropy, &res);
+        return res;
+    }();
+    return instance;
+}
+
+void apply_texture_options(TextureOptions const& options)
 {
-    glBindTexture(GL_TEXTURE_2D, _id.id());
-    std::visit([&](auto&& source) { upload_image_data(source); }, source);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, static_cast<GLint>(options.minification_filter));
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, static_cast<GLint>(options.magnification_filter));
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, static_cast<GLint>(options.wrap_x));
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, static_cast<GLint>(options.wrap_y));
     glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, glm::value_ptr(options.border_color));
+    if (max_supported_anisotropy() > 1.f)
+        glTexParameterf(GL_TEXTURE_2D, texture_max_anisotropy, std::clamp(options.max_anisotropy, 1.f, max_supported_anisotropy()));
+}
+
+} // namespace internal
+
+Texture::Texture(AnyTextureSource const& source, TextureOptions const& options)
+{
+    glBindTexture(GL_TEXTURE_2D, _id.id());
+    std::visit([&](auto&& source) { upload_image_data(source); }, source);
+    internal::apply_texture_options(options);
+    if (internal::uses_mipmaps(options.minification_filter) && !std::holds_alternative<TextureSource::EmptyImage>(source))
+        glGenerateMipmap(GL_TEXTURE_2D);
+}
+
+void Texture::generate_mipmaps() const
+{
+    glBindTexture(GL_TEXTURE_2D, _id.id());
+    glGenerateMipmap(GL_TEXTURE_2D);
 }
 
 } // namespace gl
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <filesystem>
 #include <span>
 #include <variant>
+#include "TextureUnits.hpp"
 #include "glad/gl.h"
 #include "glm/glm.hpp"
 
@@ -285,10 +286,14 @@ enum class Type : GLenum {
     UnsignedInt_2_10_10_10_Rev = GL_UNSIGNED_INT_2_10_10_10_REV,
 };
 
+/// The *Mipmap* filters can only be used for minification. They make the texture generate its mipmaps, which avoids aliasing and is faster when the texture is drawn smaller than its actual size.
 enum class Filter : GLint {
-    NearestNeighbour   = GL_NEAREST,
-    Linear             = GL_LINEAR,
-    LinearMipmapLinear = GL_LINEAR_MIPMAP_LINEAR,
+    NearestNeighbour     = GL_NEAREST,
+    Linear               = GL_LINEAR,
+    NearestMipmapNearest = GL_NEAREST_MIPMAP_NEAREST,
+    LinearMipmapNearest  = GL_LINEAR_MIPMAP_NEAREST, /// Bilinear
+    NearestMipmapLinear  = GL_NEAREST_MIPMAP_LINEAR,
+    LinearMipmapLinear   = GL_LINEAR_MIPMAP_LINEAR, /// Trilinear
 };
 
 enum class Wrap : GLint {
@@ -307,6 +312,7 @@ public:
     }
     ~UniqueTexture()
     {
+        TextureUnits::instance().forget(_id);
         glDeleteTextures(1, &_id);
     }
     UniqueTexture(UniqueTexture const&)                    = delete; // You cannot copy
@@ -320,6 +326,7 @@ public:
     {
         if (&o != this)
         {
+            TextureUnits::instance().forget(_id);
             glDeleteTextures(1, &_id);
             _id   = o._id;
             o._id = 0;
@@ -352,6 +359,7 @@ struct EmptyImage {
     GLsizei             width{};
     GLsizei             height{};
     InternalFormatSized texture_format{InternalFormatSized::RGBA8};
+    GLsizei             mip_levels{1}; /// 0 allocates the whole mip chain, down to 1x1. Fill the other levels with Texture::generate_mipmaps() once you have rendered to the first one.
 };
 } // namespace TextureSource
 
@@ -366,14 +374,32 @@ struct TextureOptions {
     Wrap      wrap_x{Wrap::ClampToEdge};
     Wrap      wrap_y{Wrap::ClampToEdge};
     glm::vec4 border_color{0.f}; // Only used when at least one of the Wrap is set to ClampToBorder
+    float     max_anisotropy{1.f}; /// Keeps textures sharp when they are seen at a grazing angle. Clamped to what the GPU supports, and ignored if it doesn't support anisotropic filtering.
+
+    auto operator==(TextureOptions const&) const -> bool = default;
 };
 
+namespace internal {
+// GL_TEXTURE_MAX_ANISOTROPY and GL_MAX_TEXTURE_MAX_ANISOTROPY, which glad doesn't define because they are only core since OpenGL 4.6
+constexpr GLenum texture_max_anisotropy     = 0x84FE;
+constexpr GLenum max_texture_max_anisotropy = 0x84FF;
+
+/// Sets the options on the texture currently bound to GL_TEXTURE_2D
+void apply_texture_options(TextureOptions const&);
+auto uses_mipmaps(Filter) -> bool;
+/// 1 if anisotropic filtering isn't supported
+auto max_supported_anisotropy() -> float;
+} // namespace internal
+
 class Texture {
 public:
     explicit Texture(AnyTextureSource const&, TextureOptions const& = {});
 
     auto id() const -> GLuint { return _id.id(); }
 
+    /// Computes all the mip levels from the first one. Done automatically when creating a texture from a File or Pixels with a *Mipmap* minification filter.
+    void generate_mipmaps() const;
+
 private:
     internal::UniqueTexture _id{};
 };
@@ -0,0 +1,218 @@
+#include "TextureAtlas.hpp"
+#include <algorithm>
+#include <format>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include "handle_error.hpp"
+#include "img/img.hpp"
+#include "make_absolute_path.hpp"
+
+namespace gl {
+
+namespace internal {
+
+SkylinePacker::SkylinePacker(GLsizei width, GLsizei max_height)
+    : _width{width}
+    , _max_height{max_height}
+    , _skyline{{0, 0, width}}
+{
+}
+
+// Returns the height at which the rectangle would be placed if its left side was at the start of the given segment
+auto SkylinePacker::fit(size_t segment_index, GLsizei width, GLsizei height) const -> std::optional<GLsizei>
+{
+    GLsizei const x = _skyline[segment_index].x;
+    if (x + width > _width)
+        return std::nullopt;
+    GLsizei y          = 0;
+    GLsizei width_left = width;
+    for (size_t i = segment_index; width_left > 0; ++i)
+    {
+        y = std::max(y, _skyline[i].y);
+        if (y + height > _max_height)
+            return std::nullopt;
+        width_left -= _skyline[i].width;
+    }
+    return y;
+}
+
+auto SkylinePacker::insert(GLsizei width, GLsizei height) -> std::optional<glm::ivec2>
+{
+    size_t  best_index = _skyline.size();
+    GLsizei best_top   = std::numeric_limits<GLsizei>::max();
+    GLsizei best_y     = 0;
+    for (size_t i = 0; i < _skyline.size(); ++i)
+    {
+        auto const y = fit(i, width, height);
+        // Lowest top first, then the narrowest segment to waste less space
+        if (y.has_value() && (*y + height < best_top || (*y + height == best_top && _skyline[i].width < _skyline[best_index].width)))
+        {
+            best_index = i;
+            best_top   = *y + height;
+            best_y     = *y;
+        }
+    }
+    if (best_index == _skyline.size())
+        return std::nullopt;
+
+    // The new rectangle covers the segments below it
+    auto const position = glm::ivec2{_skyline[best_index].x, best_y};
+    _skyline.insert(_skyline.begin() + static_cast<std::ptrdiff_t>(best_index), Segment{position.x, best_top, width});
+    for (size_t i = best_index + 1; i < _skyline.size();)
+    {
+        auto&         segment = _skyline[i];
+        GLsizei const covered = position.x + width - segment.x;
+        if (covered <= 0)
+            break;
+        if (covered < segment.width)
+        {
+            segment.x += covered;
+            segment.width -= covered;
+            break;
+        }
+        _skyline.erase(_skyline.begin() + static_cast<std::ptrdiff_t>(i));
+    }
+    // Merge neighbours at the same height
+    for (size_t i = 0; i + 1 < _skyline.size();)
+    {
+        if (_skyline[i].y == _skyline[i + 1].y)
+        {
+            _skyline[i].width += _skyline[i + 1].width;
+            _skyline.erase(_skyline.begin() + static_cast<std::ptrdiff_t>(i + 1));
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    return position;
+}
+
+auto SkylinePacker::used_height() const -> GLsizei
+{
+    return std::max_element(_skyline.begin(), _skyline.end(), [](Segment const& a, Segment const& b) { return a.y < b.y; })->y;
+}
+
+} // namespace internal
+
+// Copies the image, and repeats its border pixels in the padding around it
+static void blit_with_padding(img::Image const& image, img::Image& page, glm::ivec2 position, GLsizei padding)
+{
+    auto const width      = static_cast<GLsizei>(image.width());
+    auto const height     = static_cast<GLsizei>(image.height());
+    auto const page_width = static_cast<GLsizei>(page.width());
+    for (GLsizei y = -padding; y < height + padding; ++y)
+    {
+        GLsizei const source_y = std::clamp(y, 0, height - 1);
+        for (GLsizei x = -padding; x < width + padding; ++x)
+        {
+            GLsizei const source_x = std::clamp(x, 0, width - 1);
+            auto const    source   = static_cast<size_t>(source_y * width + source_x) * 4;
+            auto const    target   = static_cast<size_t>((position.y + y) * page_width + position.x + x) * 4;
+            std::copy_n(image.data() + source, 4, page.data() + target);
+        }
+    }
+}
+
+namespace internal {
+
+auto pack_atlas(std::span<img::Image const> sprites, TextureAtlas_Descriptor const& desc) -> PackedAtlas
+{
+    for (size_t i = 0; i < sprites.size(); ++i)
+    {
+        if (std::cmp_greater(sprites[i].width() + 2 * static_cast<size_t>(desc.padding), desc.page_size)
+            || std::cmp_greater(sprites[i].height() + 2 * static_cast<size_t>(desc.padding), desc.page_size))
+            handle_error(std::format("[TextureAtlas] \"{}\" doesn't fit in a page of {}x{} pixels", desc.sprites.at(i).string(), desc.page_size, desc.page_size));
+    }
+
+    // Packing the tallest images first gives a flatter skyline
+    std::vector<size_t> order(sprites.size());
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return sprites[a].height() > sprites[b].height(); });
+
+    struct Page {
+        SkylinePacker           packer;
+        std::vector<size_t>     sprites{};
+        std::vector<glm::ivec2> positions{};
+    };
+    std::vector<Page> pages{};
+    for (size_t const sprite : order)
+    {
+        auto const width  = static_cast<GLsizei>(sprites[sprite].width()) + 2 * desc.padding;
+        auto const height = static_cast<GLsizei>(sprites[sprite].height()) + 2 * desc.padding;
+        std::optional<glm::ivec2> position{};
+        for (auto& page : pages)
+        {
+            position = page.packer.insert(width, height);
+            if (position.has_value())
+            {
+                page.sprites.push_back(sprite);
+                page.positions.push_back(*position + desc.padding);
+                break;
+            }
+        }
+        if (!position.has_value())
+        {
+            pages.push_back(Page{.packer = SkylinePacker{desc.page_size, desc.page_size}});
+            position = pages.back().packer.insert(width, height);
+            pages.back().sprites.push_back(sprite);
+            pages.back().positions.push_back(*position + desc.padding);
+        }
+    }
+
+    PackedAtlas atlas{};
+    atlas.regions.resize(sprites.size());
+    atlas.pages.reserve(pages.size());
+    for (size_t page_index = 0; page_index < pages.size(); ++page_index)
+    {
+        auto const& page        = pages[page_index];
+        auto const  page_width  = desc.page_size;
+        auto const  page_height = page.packer.used_height(); // Don't waste memory on the empty top of the last page
+        auto&       pixels      = atlas.pages.emplace_back(
+            img::Size{static_cast<img::Size::DataType>(page_width), static_cast<img::Size::DataType>(page_height)},
+            4,
+            new uint8_t[static_cast<size_t>(page_width) * static_cast<size_t>(page_height) * 4]{}
+        );
+        for (size_t i = 0; i < page.sprites.size(); ++i)
+        {
+            auto const& image    = sprites[page.sprites[i]];
+            auto const  position = page.positions[i];
+            blit_with_padding(image, pixels, position, desc.padding);
+
+            auto& region          = atlas.regions[page.sprites[i]];
+            region.page           = page_index;
+            region.size_in_pixels = glm::ivec2{image.width(), image.height()};
+            region.uv_min         = glm::vec2{position} / glm::vec2{page_width, page_height};
+            region.uv_max         = glm::vec2{position + region.size_in_pixels} / glm::vec2{page_width, page_height};
+        }
+    }
+    return atlas;
+}
+
+} // namespace internal
+
+TextureAtlas::TextureAtlas(TextureAtlas_Descriptor const& desc)
+{
+    std::vector<img::Image> images{};
+    images.reserve(desc.sprites.size());
+    for (auto const& path : desc.sprites)
+        images.push_back(img::load(make_absolute_path(path), 4, desc.flip_y));
+
+    auto atlas = internal::pack_atlas(images, desc);
+    _regions   = std::move(atlas.regions);
+    for (auto const& page : atlas.pages)
+    {
+        _pages.emplace_back(
+            TextureSource::Pixels{
+                .pixels         = page.data_span(),
+                .width          = static_cast<GLsizei>(page.width()),
+                .height         = static_cast<GLsizei>(page.height()),
+                .texture_format = InternalFormat::RGBA8,
+            },
+            desc.options
+        );
+    }
+}
+
+} // namespace gl
@@ -0,0 +1,92 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+#include "Texture.hpp"
+#include "glm/glm.hpp"
+#include "img/img.hpp"
+
+namespace gl {
+
+struct TextureAtlas_Descriptor {
+    std::vector<std::filesystem::path> sprites{};
+    GLsizei                            page_size{2048}; /// Width and maximum height of each page
+    /// Pixels around each sprite, filled with the border of the sprite so that filtering doesn't bleed into its neighbours.
+    /// Each mip level halves it: the default only protects the full-size level. To sample mip level n without bleeding, use a padding of at least 2^(n+1).
+    GLsizei                            padding{2};
+    bool                               flip_y{true};    /// See TextureSource::File::flip_y
+    TextureOptions                     options{};
+};
+
+/// Where a sprite ended up in the atlas
+struct AtlasRegion {
+    size_t     page{};
+    glm::vec2  uv_min{}; /// Texture coordinates of the bottom-left corner of the sprite in its page
+    glm::vec2  uv_max{}; /// Texture coordinates of the top-right corner of the sprite in its page
+    glm::ivec2 size_in_pixels{};
+};
+
+/// Packs many small images into a few big textures, so that they can all be drawn without switching textures.
+/// NB: the constructor decodes the images on the calling thread. Use TextureLoader::load_atlas() to do it in the background.
+class TextureAtlas {
+public:
+    /// Throws if an image can't be loaded, or is bigger than a page
+    explicit TextureAtlas(TextureAtlas_Descriptor const&);
+
+    /// Regions are in the same order as TextureAtlas_Descriptor::sprites
+    auto region(size_t sprite_index) const -> AtlasRegion const& { return _regions.at(sprite_index); }
+    auto regions() const -> std::span<AtlasRegion const> { return _regions; }
+    auto page(size_t index) const -> Texture const& { return _pages.at(index); }
+    auto pages_count() const -> size_t { return _pages.size(); }
+
+private:
+    friend class TextureLoader;
+    TextureAtlas(std::vector<AtlasRegion> regions, std::vector<Texture> pages)
+        : _regions{std::move(regions)}
+        , _pages{std::move(pages)}
+    {}
+
+private:
+    std::vector<AtlasRegion> _regions{};
+    std::vector<Texture>     _pages{};
+};
+
+namespace internal {
+/// Result of the packing, before anything is sent to the GPU
+struct PackedAtlas {
+    std::vector<AtlasRegion> regions{};
+    std::vector<img::Image>  pages{}; /// RGBA8
+};
+/// Doesn't call OpenGL, so it can run on any thread. The sprites must be RGBA8. Throws if a sprite is bigger than a page.
+auto pack_atlas(std::span<img::Image const> sprites, TextureAtlas_Descriptor const&) -> PackedAtlas;
+
+/// Skyline bottom-left packer: keeps the top edge of the packed rectangles as a list of horizontal segments,
+/// and puts each new rectangle where its top ends up the lowest
+class SkylinePacker {
+public:
+    SkylinePacker(GLsizei width, GLsizei max_height);
+
+    /// Returns the position of the bottom-left corner of the rectangle, or nothing if it doesn't fit
+    auto insert(GLsizei width, GLsizei height) -> std::optional<glm::ivec2>;
+    /// Height actually used by the rectangles that have been inserted
+    auto used_height() const -> GLsizei;
+
+private:
+    struct Segment {
+        GLsizei x;
+        GLsizei y;
+        GLsizei width;
+    };
+
+    auto fit(size_t segment_index, GLsizei width, GLsizei height) const -> std::optional<GLsizei>;
+
+private:
+    GLsizei              _width;
+    GLsizei              _max_height;
+    std::vector<Segment> _skyline{};
+};
+} // namespace internal
+
+} // namespace gl
@@ -0,0 +1,312 @@
+#include "TextureLoader.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include "make_absolute_path.hpp"
+
+namespace gl {
+
+static constexpr size_t bytes_per_upload = size_t{1} << 20; // Small enough to split big images across several frames
+
+TextureLoader::TextureLoader(TextureLoader_Descriptor const& desc)
+    : _desc{desc}
+{
+    for (size_t i = 0; i < std::max(_desc.threads_count, size_t{1}); ++i)
+        _threads.emplace_back([this]() { decode_loop(); });
+}
+
+TextureLoader::~TextureLoader()
+{
+    {
+        std::scoped_lock lock{_mutex};
+        _stopping = true;
+        _jobs.clear();
+    }
+    _jobs_changed.notify_all();
+    for (auto& thread : _threads)
+        thread.join();
+}
+
+auto TextureLoader::make_placeholder(TextureOptions const& options) const -> std::shared_ptr<internal::AsyncTextureState>
+{
+    auto const pixel = std::array<uint8_t, 4>{
+        static_cast<uint8_t>(glm::clamp(_desc.placeholder_color.r, 0.f, 1.f) * 255.f),
+        static_cast<uint8_t>(glm::clamp(_desc.placeholder_color.g, 0.f, 1.f) * 255.f),
+        static_cast<uint8_t>(glm::clamp(_desc.placeholder_color.b, 0.f, 1.f) * 255.f),
+        static_cast<uint8_t>(glm::clamp(_desc.placeholder_color.a, 0.f, 1.f) * 255.f),
+    };
+    return std::make_shared<internal::AsyncTextureState>(internal::AsyncTextureState{
+        .texture = Texture{TextureSource::Pixels{.pixels = pixel, .width = 1, .height = 1}, options},
+    });
+}
+
+auto TextureLoader::load(TextureSource::File const& source, TextureOptions const& options) -> AsyncTexture
+{
+    auto state = make_placeholder(options);
+    {
+        std::scoped_lock lock{_mutex};
+        _jobs.push_back(Job{
+            .path           = make_absolute_path(source.path),
+            .flip_y         = source.flip_y,
+            .texture_format = source.texture_format,
+            .options        = options,
+            .target         = state,
+        });
+    }
+    _jobs_changed.notify_one();
+    _pending_count++;
+    return AsyncTexture{std::move(state)};
+}
+
+auto TextureLoader::load_atlas(TextureAtlas_Descriptor const& desc) -> AsyncTextureAtlas
+{
+    auto state = std::make_shared<internal::AsyncTextureAtlasState>();
+    {
+        std::scoped_lock lock{_mutex};
+        _atlas_jobs.push_back(AtlasJob{.desc = desc, .target = state});
+        for (auto& path : _atlas_jobs.back().desc.sprites)
+            path = make_absolute_path(path);
+    }
+    _jobs_changed.notify_one();
+    _pending_count++;
+    return AsyncTextureAtlas{std::move(state)};
+}
+
+static void flip_rows(img::Image& image)
+{
+    size_t const row_size = static_cast<size_t>(image.width()) * static_cast<size_t>(image.channels_count());
+    auto         row      = std::vector<uint8_t>(row_size);
+    for (size_t top = 0, bottom = image.height() - 1; top < bottom; ++top, --bottom)
+    {
+        std::memcpy(row.data(), image.data() + top * row_size, row_size);
+        std::memcpy(image.data() + top * row_size, image.data() + bottom * row_size, row_size);
+        std::memcpy(image.data() + bottom * row_size, row.data(), row_size);
+    }
+}
+
+// We always ask stb_image not to flip, so that the threads don't fight over its global setting
+static auto decode(std::filesystem::path const& path, bool flip_y) -> img::Image
+{
+    auto image = img::load(path, 4, /*flip_vertically=*/false);
+    if (flip_y)
+        flip_rows(image);
+    return image;
+}
+
+void TextureLoader::decode_loop()
+{
+    while (true)
+    {
+        std::optional<Job>      job{};
+        std::optional<AtlasJob> atlas_job{};
+        {
+            std::unique_lock lock{_mutex};
+            _jobs_changed.wait(lock, [&]() { return _stopping || !_jobs.empty() || !_atlas_jobs.empty(); });
+            if (_stopping)
+                return;
+            if (!_jobs.empty())
+            {
+                job = std::move(_jobs.front());
+                _jobs.pop_front();
+            }
+            else
+            {
+                atlas_job = std::move(_atlas_jobs.front());
+                _atlas_jobs.pop_front();
+            }
+        }
+
+        if (job.has_value())
+        {
+            if (!job->target.expired()) // Nobody wants this texture anymore
+            {
+                try
+                {
+                    job->image = decode(job->path, job->flip_y);
+                }
+                catch (std::exception const& e)
+                {
+                    job->error = e.what();
+                }
+            }
+            std::scoped_lock lock{_mutex};
+            _decoded.push_back(std::move(*job));
+        }
+        else
+        {
+            if (!atlas_job->target.expired())
+            {
+                try
+                {
+                    std::vector<img::Image> sprites{};
+                    sprites.reserve(atlas_job->desc.sprites.size());
+                    for (auto const& path : atlas_job->desc.sprites)
+                        sprites.push_back(decode(path, atlas_job->desc.flip_y));
+                    atlas_job->packed = internal::pack_atlas(sprites, atlas_job->desc);
+                }
+                catch (std::exception const& e)
+                {
+                    atlas_job->error = e.what();
+                }
+            }
+            std::scoped_lock lock{_mutex};
+            _decoded_atlases.push_back(std::move(*atlas_job));
+        }
+    }
+}
+
+auto TextureLoader::upload_some_rows(Upload& upload) -> UploadProgress
+{
+    auto const state = upload.job.target.lock();
+    if (!state)
+        return UploadProgress::Done; // The texture has been destroyed in the meantime
+    if (!upload.job.image.has_value())
+    {
+        std::cerr << "[TextureLoader] " << upload.job.error << '\n';
+        state->has_failed = true;
+        return UploadProgress::Done;
+    }
+
+    auto const& image    = *upload.job.image;
+    auto const  width    = static_cast<GLsizei>(image.width());
+    auto const  height   = static_cast<GLsizei>(image.height());
+    auto const  row_size = static_cast<size_t>(width) * 4;
+    glBindTexture(GL_TEXTURE_2D, state->texture.id());
+
+    if (upload.next_row < 0)
+    {
+        // Replaces the placeholder, the texture keeps its id
+        glTexImage2D(GL_TEXTURE_2D, 0, static_cast<GLint>(upload.job.texture_format), width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        upload.next_row = 0;
+    }
+
+    auto const rows = std::min(height - upload.next_row, static_cast<GLsizei>(std::max(bytes_per_upload / row_size, size_t{1})));
+    auto const size = static_cast<size_t>(rows) * row_size;
+
+    // Orphaning the buffer lets the driver give us fresh memory instead of waiting for the previous upload to be done
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pixel_buffer.id());
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+    void* const mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(size), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped == nullptr)
+    {
+        // Same rows again next frame, the driver may have run out of memory for now
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return UploadProgress::MapFailed;
+    }
+    std::memcpy(mapped, image.data() + static_cast<size_t>(upload.next_row) * row_size, size);
+    if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_FALSE)
+    {
+        // The content of the buffer has been lost (e.g. the screen mode changed), send the same rows again
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return UploadProgress::MapFailed;
+    }
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, upload.next_row, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, nullptr); // Reads from the bound buffer
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    upload.next_row += rows;
+
+    if (upload.next_row < height)
+        return UploadProgress::Uploading;
+
+    auto options = upload.job.options;
+    if (_desc.generate_mipmaps && options.minification_filter == Filter::Linear)
+        options.minification_filter = Filter::LinearMipmapLinear;
+    if (_desc.generate_mipmaps || internal::uses_mipmaps(options.minification_filter))
+        glGenerateMipmap(GL_TEXTURE_2D);
+    internal::apply_texture_options(options);
+    state->is_ready = true;
+    return UploadProgress::Done;
+}
+
+// The pages become AsyncTextures of their own, so that they go through the same uploads as the other images
+void TextureLoader::start_atlas_upload(AtlasJob& job)
+{
+    auto const state = job.target.lock();
+    if (!state)
+    {
+        _pending_count--; // The atlas has been destroyed in the meantime
+        return;
+    }
+    if (!job.packed.has_value())
+    {
+        std::cerr << "[TextureLoader] " << job.error << '\n';
+        state->has_failed = true;
+        _pending_count--;
+        return;
+    }
+
+    auto& atlas = _atlas_uploads.emplace_back(AtlasUpload{.target = state, .regions = std::move(job.packed->regions)});
+    for (auto& page : job.packed->pages)
+    {
+        auto page_state = make_placeholder(job.desc.options);
+        _uploads.push_back(Upload{.job = Job{
+                                      .path           = {},
+                                      .flip_y         = false,
+                                      .texture_format = InternalFormat::RGBA8,
+                                      .options        = job.desc.options,
+                                      .target         = page_state,
+                                      .image          = std::move(page),
+                                  }});
+        atlas.pages.push_back(std::move(page_state));
+        _pending_count++;
+    }
+}
+
+auto TextureLoader::finish_atlas(AtlasUpload& upload) -> bool
+{
+    auto const state = upload.target.lock();
+    if (!state)
+        return true;
+    if (std::any_of(upload.pages.begin(), upload.pages.end(), [](auto const& page) { return page->has_failed; }))
+    {
+        state->has_failed = true;
+        return true;
+    }
+    if (!std::all_of(upload.pages.begin(), upload.pages.end(), [](auto const& page) { return page->is_ready; }))
+        return false;
+
+    std::vector<Texture> pages{};
+    pages.reserve(upload.pages.size());
+    for (auto& page : upload.pages)
+        pages.push_back(std::move(page->texture)); // Keeps its id
+    state->atlas.emplace(TextureAtlas{std::move(upload.regions), std::move(pages)});
+    return true;
+}
+
+void TextureLoader::update()
+{
+    std::vector<AtlasJob> decoded_atlases{};
+    {
+        std::scoped_lock lock{_mutex};
+        for (auto& job : _decoded)
+            _uploads.push_back(Upload{.job = std::move(job)});
+        _decoded.clear();
+        std::swap(decoded_atlases, _decoded_atlases);
+    }
+    for (auto& job : decoded_atlases)
+        start_atlas_upload(job);
+
+    using clock         = std::chrono::steady_clock;
+    auto const deadline = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<float, std::milli>{_desc.upload_budget_in_milliseconds});
+    while (!_uploads.empty())
+    {
+        auto const progress = upload_some_rows(_uploads.front());
+        if (progress == UploadProgress::MapFailed)
+            break; // Retry next frame
+        if (progress == UploadProgress::Done)
+        {
+            _uploads.pop_front();
+            _pending_count--;
+        }
+        if (clock::now() >= deadline)
+            break;
+    }
+
+    auto const finished = std::remove_if(_atlas_uploads.begin(), _atlas_uploads.end(), [&](AtlasUpload& atlas) { return finish_atlas(atlas); });
+    _pending_count -= static_cast<size_t>(std::distance(finished, _atlas_uploads.end()));
+    _atlas_uploads.erase(finished, _atlas_uploads.end());
+}
+
+} // namespace gl
@@ -0,0 +1,150 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Texture.hpp"
+#include "TextureAtlas.hpp"
+#include "UniqueBuffer.hpp"
+#include "img/img.hpp"
+
+namespace gl {
+
+namespace internal {
+struct AsyncTextureState {
+    Texture texture;
+    bool    is_ready{false};
+    bool    has_failed{false};
+};
+struct AsyncTextureAtlasState {
+    std::optional<TextureAtlas> atlas{};
+    bool                        has_failed{false};
+};
+} // namespace internal
+
+/// Texture returned by a TextureLoader. It starts as a 1x1 placeholder, and the same OpenGL texture gets filled with the image once it is loaded,
+/// so id() never changes and you can use it right away.
+class AsyncTexture {
+public:
+    auto texture() const -> Texture const& { return _state->texture; }
+    auto id() const -> GLuint { return _state->texture.id(); }
+    auto is_ready() const -> bool { return _state->is_ready; }
+    /// The texture then stays a placeholder forever. The error has been printed to std::cerr.
+    auto has_failed() const -> bool { return _state->has_failed; }
+
+private:
+    friend class TextureLoader;
+    explicit AsyncTexture(std::shared_ptr<internal::AsyncTextureState> state)
+        : _state{std::move(state)}
+    {}
+
+private:
+    std::shared_ptr<internal::AsyncTextureState> _state;
+};
+
+/// Atlas returned by a TextureLoader. Unlike AsyncTexture there is no placeholder, because the regions are only known once all the images have been decoded.
+class AsyncTextureAtlas {
+public:
+    /// nullptr until all the pages have been uploaded
+    auto atlas() const -> TextureAtlas const* { return _state->atlas.has_value() ? &*_state->atlas : nullptr; }
+    auto is_ready() const -> bool { return _state->atlas.has_value(); }
+    /// The atlas then never becomes ready. The error has been printed to std::cerr.
+    auto has_failed() const -> bool { return _state->has_failed; }
+
+private:
+    friend class TextureLoader;
+    explicit AsyncTextureAtlas(std::shared_ptr<internal::AsyncTextureAtlasState> state)
+        : _state{std::move(state)}
+    {}
+
+private:
+    std::shared_ptr<internal::AsyncTextureAtlasState> _state;
+};
+
+struct TextureLoader_Descriptor {
+    size_t    threads_count{2};                    /// Number of threads decoding images
+    float     upload_budget_in_milliseconds{2.f};  /// Time update() can spend sending pixels to the GPU each frame
+    bool      generate_mipmaps{true};              /// If true, textures using Filter::Linear for minification will use Filter::LinearMipmapLinear instead
+    glm::vec4 placeholder_color{1.f, 0.f, 1.f, 1.f};
+};
+
+/// Loads image files without blocking the rendering: images are decoded on worker threads,
+/// then sent to the GPU through a pixel buffer object, a few rows at a time, within a time budget per frame.
+/// NB: stb_image stores its vertical flip setting in a global, so while images are being decoded you should not call img::load() with flip_vertically = true yourself.
+class TextureLoader {
+public:
+    explicit TextureLoader(TextureLoader_Descriptor const& = {});
+    ~TextureLoader();
+    TextureLoader(TextureLoader const&)                    = delete; // You cannot copy
+    auto operator=(TextureLoader const&) -> TextureLoader& = delete; // nor move a TextureLoader, its threads refer to it
+
+    [[nodiscard]] auto load(TextureSource::File const&, TextureOptions const& = {}) -> AsyncTexture;
+    /// The sprites are decoded and packed on a worker thread, then the pages are uploaded like the other textures.
+    [[nodiscard]] auto load_atlas(TextureAtlas_Descriptor const&) -> AsyncTextureAtlas;
+
+    /// Must be called once per frame, on the OpenGL thread. Uploads the decoded images until the time budget is spent.
+    void update();
+
+    /// Number of images that are not ready yet (an atlas counts as one image)
+    auto pending_count() const -> size_t { return _pending_count; }
+
+private:
+    struct Job {
+        std::filesystem::path                          path;
+        bool                                           flip_y;
+        InternalFormat                                 texture_format;
+        TextureOptions                                 options;
+        std::weak_ptr<internal::AsyncTextureState>     target;
+        std::optional<img::Image>                      image{};
+        std::string                                    error{};
+    };
+    struct Upload {
+        Job     job;
+        GLsizei next_row{-1}; // -1 until the storage of the texture has been allocated
+    };
+    struct AtlasJob {
+        TextureAtlas_Descriptor                          desc;
+        std::weak_ptr<internal::AsyncTextureAtlasState>  target;
+        std::optional<internal::PackedAtlas>             packed{};
+        std::string                                      error{};
+    };
+    // Atlas whose pages are being uploaded
+    struct AtlasUpload {
+        std::weak_ptr<internal::AsyncTextureAtlasState>           target;
+        std::vector<AtlasRegion>                                  regions;
+        std::vector<std::shared_ptr<internal::AsyncTextureState>> pages{};
+    };
+
+    void decode_loop();
+    auto make_placeholder(TextureOptions const&) const -> std::shared_ptr<internal::AsyncTextureState>;
+    void start_atlas_upload(AtlasJob&);
+    enum class UploadProgress {
+        Uploading,
+        Done,      // The whole image has been uploaded, or there is nothing left to upload
+        MapFailed, // Nothing has been uploaded, try again later
+    };
+    auto upload_some_rows(Upload&) -> UploadProgress;
+    auto finish_atlas(AtlasUpload&) -> bool; // Returns true once all the pages have been uploaded, or one of them has failed
+
+private:
+    TextureLoader_Descriptor _desc;
+    size_t                   _pending_count{0};
+    std::deque<Upload>       _uploads{}; // Owned by the OpenGL thread
+    std::vector<AtlasUpload> _atlas_uploads{}; // Owned by the OpenGL thread
+    internal::UniqueBuffer   _pixel_buffer{};
+
+    std::mutex               _mutex{};
+    std::condition_variable  _jobs_changed{};
+    std::deque<Job>          _jobs{};
+    std::vector<Job>         _decoded{};
+    std::deque<AtlasJob>     _atlas_jobs{};
+    std::vector<AtlasJob>    _decoded_atlases{};
+    bool                     _stopping{false};
+    std::vector<std::thread> _threads{};
+};
+
+} // namespace gl
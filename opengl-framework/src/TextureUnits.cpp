@@ -0,0 +1,114 @@
+#include "TextureUnits.hpp"
+#include <algorithm>
+#include "glfw.hpp"
+#include "has_extension.hpp"
+
+namespace gl::internal {
+
+auto TextureUnits::instance() -> TextureUnits&
+{
+    // Never destroyed, because textures stored in static variables might still call forget() after it would have been
+    static auto* const instance = new TextureUnits{}; // NOLINT(*owning-memory)
+    return *instance;
+}
+
+auto TextureUnits::bind(GLuint texture_id, GLuint sampler_id) -> GLuint
+{
+    if (_units.empty())
+    {
+        GLint units_count{};
+        glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &units_count);
+        _units.resize(static_cast<size_t>(units_count));
+    }
+
+    auto const bind_sampler = [&](GLuint unit) {
+        if (_units[unit].sampler_id == sampler_id)
+            return;
+        glBindSampler(unit, sampler_id);
+        _units[unit].sampler_id = sampler_id;
+    };
+
+    auto const it = _unit_of_texture.find(texture_id);
+    if (it != _unit_of_texture.end())
+    {
+        _units[it->second].last_use = ++_uses_count;
+        bind_sampler(it->second);
+        return it->second;
+    }
+
+    auto const least_recently_used = std::min_element(_units.begin() + 1, _units.end(), [](Unit const& a, Unit const& b) { return a.last_use < b.last_use; });
+    auto const unit                = static_cast<GLuint>(least_recently_used - _units.begin());
+    if (least_recently_used->texture_id != 0)
+        _unit_of_texture.erase(least_recently_used->texture_id);
+    least_recently_used->texture_id = texture_id;
+    least_recently_used->last_use   = ++_uses_count;
+    _unit_of_texture[texture_id]    = unit;
+
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glActiveTexture(GL_TEXTURE0);
+    bind_sampler(unit);
+    return unit;
+}
+
+void TextureUnits::forget(GLuint texture_id)
+{
+    _bindless_handles.erase(texture_id);
+    auto const it = _unit_of_texture.find(texture_id);
+    if (it == _unit_of_texture.end())
+        return;
+    // Deleting a texture unbinds it, so the unit is now the best one to reuse. The sampler stays bound though.
+    _units[it->second].texture_id = 0;
+    _units[it->second].last_use   = 0;
+    _unit_of_texture.erase(it);
+}
+
+void TextureUnits::load_bindless_functions()
+{
+    _bindless_checked = true;
+    if (!has_extension("GL_ARB_bindless_texture"))
+        return;
+    _get_texture_handle           = reinterpret_cast<GetTextureHandle>(glfwGetProcAddress("glGetTextureHandleARB"));                    // NOLINT(*reinterpret-cast)
+    _make_texture_handle_resident = reinterpret_cast<MakeTextureHandleResident>(glfwGetProcAddress("glMakeTextureHandleResidentARB")); // NOLINT(*reinterpret-cast)
+    _uniform_handle               = reinterpret_cast<UniformHandle>(glfwGetProcAddress("glUniformHandleui64ARB"));                      // NOLINT(*reinterpret-cast)
+    if (_get_texture_handle == nullptr || _make_texture_handle_resident == nullptr || _uniform_handle == nullptr)
+    {
+        _get_texture_handle           = nullptr;
+        _make_texture_handle_resident = nullptr;
+        _uniform_handle               = nullptr;
+    }
+}
+
+auto TextureUnits::supports_bindless() -> bool
+{
+    if (!_bindless_checked)
+        load_bindless_functions();
+    return _get_texture_handle != nullptr;
+}
+
+auto TextureUnits::bindless_handle(GLuint texture_id) -> std::optional<GLuint64>
+{
+    if (!supports_bindless())
+        return std::nullopt;
+    auto const it = _bindless_handles.find(texture_id);
+    if (it != _bindless_handles.end())
+        return it->second;
+
+    GLuint64 const handle = _get_texture_handle(texture_id);
+    if (handle == 0)
+        return std::nullopt;
+    _make_texture_handle_resident(handle);
+    _bindless_handles[texture_id] = handle;
+    return handle;
+}
+
+auto TextureUnits::set_bindless_uniform(GLint location, GLuint texture_id) -> bool
+{
+    auto const handle = bindless_handle(texture_id);
+    if (!handle.has_value())
+        return false;
+    _uniform_handle(location, *handle);
+    return true;
+}
+
+} // namespace gl::internal
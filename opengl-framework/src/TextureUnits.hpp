@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "glad/gl.h"
+
+namespace gl::internal {
+
+/// Remembers which texture is bound to which texture unit, so that using a texture that is already bound doesn't cost any OpenGL call.
+/// Unit 0 is never used: it is the one used by everybody for texture operations like resizing and setting the image, anyone might override the texture set there at any time.
+class TextureUnits {
+public:
+    static auto instance() -> TextureUnits&;
+
+    /// Returns the unit the texture is bound to, binding it to the least recently used unit if it isn't bound yet.
+    /// The sampler object is bound to the same unit (0 to use the parameters of the texture itself).
+    auto bind(GLuint texture_id, GLuint sampler_id = 0) -> GLuint;
+    /// Must be called when a texture is deleted, because OpenGL might give its id to a new texture
+    void forget(GLuint texture_id);
+
+    /// Handle of the texture for GL_ARB_bindless_texture, or nothing if the extension isn't available. The handle is made resident the first time.
+    /// After that the texture can't be modified anymore (no new image, no new parameters).
+    auto bindless_handle(GLuint texture_id) -> std::optional<GLuint64>;
+    auto supports_bindless() -> bool;
+    /// Sets a sampler uniform of the currently bound shader to the handle of the texture. Returns false if bindless textures aren't available.
+    auto set_bindless_uniform(GLint location, GLuint texture_id) -> bool;
+
+private:
+    TextureUnits() = default;
+    void load_bindless_functions();
+
+private:
+    struct Unit {
+        GLuint   texture_id{0};
+        GLuint   sampler_id{0};
+        uint64_t last_use{0};
+    };
+    std::vector<Unit>                    _units{};
+    std::unordered_map<GLuint, GLuint>   _unit_of_texture{};
+    uint64_t                             _uses_count{0};
+    std::unordered_map<GLuint, GLuint64> _bindless_handles{};
+
+    // GL_ARB_bindless_texture isn't part of the functions loaded by glad, so we load it ourselves
+    using GetTextureHandle          = GLuint64(GLAD_API_PTR*)(GLuint);
+    using MakeTextureHandleResident = void(GLAD_API_PTR*)(GLuint64);
+    using UniformHandle             = void(GLAD_API_PTR*)(GLint, GLuint64);
+    bool                      _bindless_checked{false};
+    GetTextureHandle          _get_texture_handle{nullptr};
+    MakeTextureHandleResident _make_texture_handle_resident{nullptr};
+    UniformHandle             _uniform_handle{nullptr};
+};
+
+} // namespace gl::internal
@@ -0,0 +1,40 @@
+#pragma once
+#include "glad/gl.h"
+
+namespace gl::internal {
+
+class UniqueBuffer {
+public:
+    UniqueBuffer() // NOLINT(*-member-init)
+    {
+        glGenBuffers(1, &_id);
+    }
+    ~UniqueBuffer()
+    {
+        glDeleteBuffers(1, &_id);
+    }
+    UniqueBuffer(UniqueBuffer const&)                    = delete; // You cannot copy
+    auto operator=(UniqueBuffer const&) -> UniqueBuffer& = delete; // a buffer. But you can move it, using std::move(my_buffer)
+    UniqueBuffer(UniqueBuffer&& o) noexcept
+        : _id{o._id}
+    {
+        o._id = 0;
+    }
+    auto operator=(UniqueBuffer&& o) noexcept -> UniqueBuffer&
+    {
+        if (&o != this)
+        {
+            glDeleteBuffers(1, &_id);
+            _id   = o._id;
+            o._id = 0;
+        }
+        return *this;
+    }
+
+    auto id() const { return _id; }
+
+private:
+    GLuint _id;
+};
+
+} // namespace gl::internal
@@ -0,0 +1,181 @@
+#include "VideoWriter.hpp"
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <iostream>
+#include <tuple>
+#include "handle_error.hpp"
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace gl {
+
+static auto open_output(std::filesystem::path const& path, bool& owns_file) -> int
+{
+    owns_file = path != "-";
+#if defined(_WIN32)
+    if (!owns_file)
+    {
+        _setmode(_fileno(stdout), _O_BINARY); // Otherwise every \n byte of the frames would be turned into \r\n
+        return _fileno(stdout);
+    }
+    return _wopen(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    if (!owns_file)
+        return STDOUT_FILENO;
+    return open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+}
+
+VideoWriter::VideoWriter(VideoWriter_Descriptor const& desc)
+    : _desc{desc}
+    , _queue{std::max(desc.queued_frames, size_t{1})}
+{
+    _file = open_output(_desc.path, _owns_file);
+    if (_file < 0)
+        handle_error(std::format("[VideoWriter] Failed to open \"{}\"", _desc.path.string()));
+    _thread = std::thread{[this]() { write_loop(); }};
+}
+
+VideoWriter::~VideoWriter()
+{
+    while (_readback.pending_count() != 0)
+        push_oldest_readback(/*wait=*/true);
+    _queue.close();
+    _thread.join();
+    if (_owns_file)
+    {
+#if defined(_WIN32)
+        _close(_file);
+#else
+        close(_file);
+#endif
+    }
+}
+
+void VideoWriter::capture(GLuint framebuffer, GLenum attachment, GLsizei width, GLsizei height)
+{
+    if (_frames_count == 0)
+    {
+        _width  = width;
+        _height = height;
+    }
+    else if (width != _width || height != _height)
+    {
+        handle_error(std::format("[VideoWriter] All the frames of a video must have the same size: expected {}x{} but got {}x{}", _width, _height, width, height));
+    }
+
+    // Keep one copy in flight while the previous one is read, so that we never wait for the frame that was just rendered
+    if (_readback.pending_count() == _readback.buffers_count())
+        push_oldest_readback(/*wait=*/true);
+    else
+        push_oldest_readback(/*wait=*/false);
+    std::ignore = _readback.request(framebuffer, attachment, width, height);
+    _frames_count++;
+}
+
+void VideoWriter::push_oldest_readback(bool wait)
+{
+    if (_readback.pending_count() == 0)
+        return;
+    auto&      slot     = _queue.acquire_for_writing(); // Only blocks if the disk is queued_frames behind
+    bool const has_read = wait ? _readback.get(slot) : _readback.try_get(slot);
+    if (has_read)
+        _queue.publish();
+}
+
+auto VideoWriter::write_all(void const* data, size_t size) -> bool
+{
+    auto const* bytes = static_cast<char const*>(data);
+    while (size > 0)
+    {
+#if defined(_WIN32)
+        int const written = _write(_file, bytes, static_cast<unsigned int>(std::min(size, size_t{1} << 30)));
+#else
+        ssize_t const written = write(_file, bytes, size);
+#endif
+        if (written <= 0)
+            return false;
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// OpenGL gives the rows from bottom to top, videos expect them from top to bottom
+static void flip_rgba(ReadPixels const& pixels, std::vector<uint8_t>& out)
+{
+    auto const row_size = static_cast<size_t>(pixels.width) * 4;
+    auto const height   = static_cast<size_t>(pixels.height);
+    out.resize(row_size * height);
+    for (size_t y = 0; y < height; ++y)
+        std::memcpy(out.data() + y * row_size, pixels.data.data() + (height - 1 - y) * row_size, row_size);
+}
+
+// BT.601 limited range, which is what encoders assume for Y4M files by default
+static void rgba_to_yuv444(ReadPixels const& pixels, std::vector<uint8_t>& out)
+{
+    static constexpr char frame_header[] = "FRAME\n";
+    auto const width       = static_cast<size_t>(pixels.width);
+    auto const height      = static_cast<size_t>(pixels.height);
+    auto const plane_size  = width * height;
+    auto const header_size = sizeof(frame_header) - 1;
+    out.resize(header_size + plane_size * 3);
+    std::memcpy(out.data(), frame_header, header_size);
+
+    uint8_t* y_plane = out.data() + header_size;
+    uint8_t* u_plane = y_plane + plane_size;
+    uint8_t* v_plane = u_plane + plane_size;
+    for (size_t row = 0; row < height; ++row)
+    {
+        uint8_t const* src = pixels.data.data() + (height - 1 - row) * width * 4;
+        size_t const   dst = row * width;
+        for (size_t x = 0; x < width; ++x)
+        {
+            int const r = src[x * 4 + 0];
+            int const g = src[x * 4 + 1];
+            int const b = src[x * 4 + 2];
+            y_plane[dst + x] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+            u_plane[dst + x] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            v_plane[dst + x] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
+
+void VideoWriter::write_loop()
+{
+    bool header_written = false;
+    while (ReadPixels* frame = _queue.acquire_for_reading())
+    {
+        if (!_failed)
+        {
+            bool success = true;
+            if (_desc.format == VideoFormat::Y4M && !header_written)
+            {
+                auto const header = std::format("YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C444\n", frame->width, frame->height, _desc.frames_per_second);
+                success        = write_all(header.data(), header.size());
+                header_written = true;
+            }
+
+            if (_desc.format == VideoFormat::Y4M)
+                rgba_to_yuv444(*frame, _write_buffer);
+            else
+                flip_rgba(*frame, _write_buffer);
+            // One big write per frame: this is what lets us reach the bandwidth of the disk
+            success = success && write_all(_write_buffer.data(), _write_buffer.size());
+            if (!success)
+            {
+                _failed = true;
+                std::cerr << "[VideoWriter] Failed to write to \"" << _desc.path.string() << "\", the next frames will be dropped\n";
+            }
+        }
+        _queue.release();
+    }
+}
+
+} // namespace gl
@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <filesystem>
+#include <thread>
+#include <vector>
+#include "PixelReadback.hpp"
+#include "SpscRing.hpp"
+
+namespace gl {
+
+enum class VideoFormat {
+    RawRGBA, /// 4 bytes per pixel, rows from top to bottom, no header. e.g. `ffmpeg -f rawvideo -pixel_format rgba -video_size 1920x1080 -framerate 60 -i -`
+    Y4M,     /// YUV4MPEG2 with 4:4:4 chroma, which carries its own size and frame rate. e.g. `ffmpeg -i -`
+};
+
+struct VideoWriter_Descriptor {
+    /// "-" writes to the standard output, to pipe the frames into an encoder. In that case nothing else must be printed to std::cout (the framework only logs to std::cerr).
+    std::filesystem::path path{};
+    VideoFormat           format{VideoFormat::RawRGBA};
+    int                   frames_per_second{60};
+    /// Number of frames that can wait for the disk. capture() only blocks once they are all waiting.
+    size_t queued_frames{8};
+};
+
+/// Streams frames to a file or to stdout, without any compression, as fast as the disk allows.
+/// Framebuffers are copied to the CPU through pixel buffer objects, and written by a background thread.
+class VideoWriter {
+public:
+    explicit VideoWriter(VideoWriter_Descriptor const&);
+    /// Writes the frames that are still in flight, then closes the file
+    ~VideoWriter();
+    VideoWriter(VideoWriter const&)                    = delete; // You cannot copy
+    auto operator=(VideoWriter const&) -> VideoWriter& = delete; // nor move a VideoWriter, its thread refers to it
+
+    /// Adds the current content of the given framebuffer attachment as the next frame (e.g. `capture(0, GL_BACK, width, height)` for the window).
+    /// All the frames must have the same size.
+    void capture(GLuint framebuffer, GLenum attachment, GLsizei width, GLsizei height);
+
+    auto frames_count() const -> size_t { return _frames_count; }
+
+private:
+    void push_oldest_readback(bool wait);
+    void write_loop();
+    auto write_all(void const* data, size_t size) -> bool;
+
+private:
+    VideoWriter_Descriptor            _desc;
+    PixelReadback                     _readback{2};
+    internal::SpscRing<ReadPixels>    _queue;
+    std::vector<uint8_t>              _write_buffer{}; // Owned by the writing thread
+    GLsizei                           _width{0};
+    GLsizei                           _height{0};
+    size_t                            _frames_count{0};
+    int                               _file{-1};
+    bool                              _owns_file{false};
+    std::atomic<bool>                 _failed{false};
+    std::thread                       _thread{};
+};
+
+} // namespace gl
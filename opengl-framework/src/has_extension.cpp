@@ -0,0 +1,30 @@
+#include "has_extension.hpp"
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "glad/gl.h"
+
+namespace gl {
+
+static auto extensions() -> std::vector<std::string> const&
+{
+    static auto const instance = []() {
+        auto  list = std::vector<std::string>{};
+        GLint extensions_count{};
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensions_count);
+        for (GLint i = 0; i < extensions_count; ++i)
+        {
+            if (auto const* const name = glGetStringi(GL_EXTENSIONS, static_cast<GLuint>(i)))
+                list.emplace_back(reinterpret_cast<char const*>(name)); // NOLINT(*reinterpret-cast)
+        }
+        return list;
+    }();
+    return instance;
+}
+
+auto has_extension(std::string_view extension_name) -> bool
+{
+    return std::find(extensions().begin(), extensions().end(), extension_name) != extensions().end();
+}
+
+} // namespace gl
@@ -0,0 +1,9 @@
+#pragma once
+#include <string_view>
+
+namespace gl {
+
+/// Whether the OpenGL driver supports the given extension, e.g. "GL_ARB_bindless_texture"
+auto has_extension(std::string_view extension_name) -> bool;
+
+} // namespace gl
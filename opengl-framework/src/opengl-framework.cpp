@@ -5,6 +5,9 @@
 #include <iostream>
 #include <vector>
 #include "Camera.hpp"
+#include "FramePacing.hpp"
+#include "FramebufferState.hpp"
+#include "LinearArena.hpp"
 #include "GLFW/glfw3.h"
 #include "Shader.hpp"
 #include "glfw.hpp"
@@ -15,8 +18,10 @@ namespace {
 struct Context { // NOLINT(*special-member-functions)
     GLFWwindow*                      window{nullptr};
     std::vector<gl::EventsCallbacks> events_callbacks{};
-    float                            last_time{0.f};
+    double                           last_time{0.};
     float                            delta_time{0.f};
+    gl::internal::FrameLimiter       frame_limiter{};
+    gl::internal::FrameTimesHistory  frame_times{};
     bool                             is_first_frame{true};
 
     ~Context()
@@ -94,7 +99,7 @@ void APIENTRY opengl_debug_callback(
     if (type == GL_DEBUG_TYPE_ERROR || type == GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR || severity == GL_DEBUG_SEVERITY_HIGH)
         gl::handle_error(message);
     else
-        std::cout << message << '\n';
+        std::cerr << message << '\n'; // Not std::cout, which can carry the frames of a VideoWriter
 }
 
 void assert_init_has_been_called()
@@ -128,9 +133,19 @@ void scroll_callback(GLFWwindow*, double x_offset, double y_offset)
     for (auto const& callbacks : context().events_callbacks)
         callbacks.on_scroll({.scroll = static_cast<float>(y_offset), .horizontal_scroll = static_cast<float>(x_offset)});
 }
+void set_default_framebuffer_viewport(int width_in_pixels, int height_in_pixels)
+{
+    auto state            = gl::internal::framebuffer_state();
+    state.viewport_x      = 0;
+    state.viewport_y      = 0;
+    state.viewport_width  = width_in_pixels;
+    state.viewport_height = height_in_pixels;
+    gl::internal::set_framebuffer_state(state);
+}
+
 void framebuffer_resized_callback(GLFWwindow*, int width_in_pixels, int height_in_pixels)
 {
-    glViewport(0, 0, width_in_pixels, height_in_pixels);
+    set_default_framebuffer_viewport(width_in_pixels, height_in_pixels);
     for (auto const& callbacks : context().events_callbacks)
         callbacks.on_framebuffer_resized({.width_in_pixels = width_in_pixels, .height_in_pixels = height_in_pixels});
 }
@@ -186,6 +201,8 @@ void init(std::string_view window_title)
         std::cerr << "[opengl_framework] Unable to create an OpenGL debug context\n";
     }
 #endif
+    set_vsync(VSync::On); // Explicit, because the default depends on the driver
+    set_default_framebuffer_viewport(framebuffer_width_in_pixels(), framebuffer_height_in_pixels()); // So that the tracked state matches the one OpenGL starts with
     glfwSetCursorPosCallback(context().window, &mouse_move_callback);
     glfwSetMouseButtonCallback(context().window, &mouse_button_callback);
     glfwSetScrollCallback(context().window, &scroll_callback);
@@ -199,6 +216,29 @@ void maximize_window()
     glfwMaximizeWindow(context().window);
 }
 
+void set_vsync(VSync vsync)
+{
+    assert_init_has_been_called();
+    bool const supports_adaptive = glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+    switch (vsync)
+    {
+    case VSync::Off:
+        glfwSwapInterval(0);
+        break;
+    case VSync::On:
+        glfwSwapInterval(1);
+        break;
+    case VSync::Adaptive:
+        glfwSwapInterval(supports_adaptive ? -1 : 1);
+        break;
+    }
+}
+
+void set_max_frames_per_second(double max_frames_per_second)
+{
+    context().frame_limiter.set_max_frames_per_second(max_frames_per_second);
+}
+
 void set_events_callbacks(std::vector<EventsCallbacks> callbacks)
 {
     context().events_callbacks = std::move(callbacks);
@@ -207,10 +247,16 @@ void set_events_callbacks(std::vector<EventsCallbacks> callbacks)
 auto window_is_open() -> bool
 {
     assert_init_has_been_called();
+    frame_arena().reset(); // The previous frame is over, nobody uses its scratch memory anymore
 
-    float const time = time_in_seconds();
+    context().frame_limiter.wait();
+    double const time = time_in_seconds();
     if (!context().is_first_frame)
-        context().delta_time = time - context().last_time;
+    {
+        double const delta_time = time - context().last_time; // In double, the difference of two big floats would lose most of its digits
+        context().delta_time    = static_cast<float>(delta_time);
+        context().frame_times.push(delta_time);
+    }
     context().last_time = time;
 
     glfwSwapBuffers(context().window);
@@ -261,9 +307,9 @@ auto window_aspect_ratio() -> float
     return static_cast<float>(w) / static_cast<float>(h);
 }
 
-auto time_in_seconds() -> float
+auto time_in_seconds() -> double
 {
-    return static_cast<float>(glfwGetTime());
+    return glfwGetTime();
 }
 
 auto delta_time_in_seconds() -> float
@@ -271,6 +317,11 @@ auto delta_time_in_seconds() -> float
     return context().delta_time;
 }
 
+auto frame_times() -> FrameTimes
+{
+    return context().frame_times.compute();
+}
+
 auto mouse_position() -> glm::vec2
 {
     double x{};
@@ -14,43 +14,44 @@ int main()
     });
 
     // TODO talk about default coordinates, and that they stretch with window : we will fix this by writing our own shader
-    auto const triangle_mesh = gl::Mesh{{
-        .vertex_buffers = {{
-            .layout = {gl::VertexAttribute::Position3D{0 /*must match the layout index in the shader*/}},
-            .data   = {
-                -1, -1, -1,
-                -1, +1, -1,
-                +1, +1, -1,
-                +1, -1, -1,
+    // clang-format off
+    static constexpr float vertices[] = {
+        -1, -1, -1,
+        -1, +1, -1,
+        +1, +1, -1,
+        +1, -1, -1,
 
-                -1, -1, +1,
-                -1, +1, +1,
-                +1, +1, +1,
-                +1, -1, +1
-                // clang-format on
-            },
-        }},
-        .index_buffer   = {
-            // clang-format off
-            0, 1, 2,
-            0, 2, 3,
-            
-            1, 5, 6,
-            1, 2, 6,
+        -1, -1, +1,
+        -1, +1, +1,
+        +1, +1, +1,
+        +1, -1, +1
+    };
+    static constexpr uint32_t indices[] = {
+        0, 1, 2,
+        0, 2, 3,
+
+        1, 5, 6,
+        1, 2, 6,
 
-            2, 6, 7,
-            2, 3, 7,
+        2, 6, 7,
+        2, 3, 7,
 
-            3, 7, 4,
-            3, 0, 4,
+        3, 7, 4,
+        3, 0, 4,
 
-            0, 4, 5,
-            0, 1, 5,
-            
-            4, 5, 6,
-            4, 6, 7
-            // clang-format on
-        },
+        0, 4, 5,
+        0, 1, 5,
+
+        4, 5, 6,
+        4, 6, 7
+    };
+    // clang-format on
+    auto const triangle_mesh = gl::Mesh{{
+        .vertex_buffers = {{
+            .layout = {gl::VertexAttribute::Position3D{0 /*must match the layout index in the shader*/}},
+            .data   = std::as_bytes(std::span{vertices}),
+        }},
+        .index_buffer = indices,
     }};
 
     auto const shader = gl::Shader{{
@@ -0,0 +1,14 @@
+#version 410
+in vec2 v_uv;
+out vec4 out_color;
+uniform sampler2D u_image;
+uniform float u_threshold;
+
+void main()
+{
+    vec3 color = texture(u_image, v_uv).rgb;
+    float brightness = max(color.r, max(color.g, color.b));
+    // Scales the color down instead of cutting it, so that pixels fade in and out of the bloom
+    float contribution = max(brightness - u_threshold, 0.) / max(brightness, 0.0001);
+    out_color = vec4(color * contribution, 1.);
+}
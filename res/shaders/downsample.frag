@@ -0,0 +1,15 @@
+#version 410
+in vec2 v_uv;
+out vec4 out_color;
+uniform sampler2D u_image;
+uniform vec2 u_texel_size; // Of the source image
+
+void main()
+{
+    // 4 bilinear taps average a 4x4 block of the source
+    vec3 color = texture(u_image, v_uv + u_texel_size * vec2(-1., -1.)).rgb
+               + texture(u_image, v_uv + u_texel_size * vec2(+1., -1.)).rgb
+               + texture(u_image, v_uv + u_texel_size * vec2(-1., +1.)).rgb
+               + texture(u_image, v_uv + u_texel_size * vec2(+1., +1.)).rgb;
+    out_color = vec4(color * 0.25, 1.);
+}
@@ -0,0 +1,11 @@
+#version 410
+
+out vec2 v_uv;
+
+// A single triangle covering the whole screen
+void main()
+{
+    vec2 position = vec2((gl_VertexID & 1) * 4. - 1., (gl_VertexID >> 1) * 4. - 1.);
+    v_uv = position * 0.5 + 0.5;
+    gl_Position = vec4(position, 0., 1.);
+}
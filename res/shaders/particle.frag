@@ -0,0 +1,23 @@
+#version 410
+
+out vec4 out_color;
+
+in vec2 v_uv;
+in vec2 v_atlas_uv;
+in vec4 v_color;
+flat in float v_textured;
+
+uniform sampler2D u_atlas;
+
+void main()
+{
+    if (v_textured > 0.5)
+    {
+        out_color = texture(u_atlas, v_atlas_uv) * v_color;
+        return;
+    }
+    vec2 dir = v_uv - vec2(0.5);
+    if (dot(dir, dir) > 0.25)
+        discard;
+    out_color = v_color;
+}
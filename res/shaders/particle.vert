@@ -0,0 +1,25 @@
+#version 410
+
+layout(location = 0) in vec2 in_corner;
+layout(location = 1) in vec2 in_position;
+layout(location = 2) in vec2 in_radius_and_textured;
+layout(location = 3) in vec4 in_color;
+layout(location = 4) in vec4 in_uv_rect;
+
+uniform float u_inverse_aspect_ratio;
+
+out vec2 v_uv;
+out vec2 v_atlas_uv;
+out vec4 v_color;
+flat out float v_textured;
+
+void main()
+{
+    vec2 position = in_position + in_radius_and_textured.x * in_corner;
+    gl_Position = vec4(position * vec2(u_inverse_aspect_ratio, 1.), 0., 1.);
+
+    v_uv = in_corner * 0.5 + 0.5;
+    v_atlas_uv = mix(in_uv_rect.xy, in_uv_rect.zw, v_uv);
+    v_color = in_color;
+    v_textured = in_radius_and_textured.y;
+}
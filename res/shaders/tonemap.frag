@@ -0,0 +1,16 @@
+#version 410
+in vec2 v_uv;
+out vec4 out_color;
+uniform sampler2D u_image;
+uniform sampler2D u_bloom;
+uniform float u_bloom_intensity;
+uniform float u_exposure;
+
+void main()
+{
+    vec3 color = texture(u_image, v_uv).rgb;
+    if (u_bloom_intensity > 0.)
+        color += texture(u_bloom, v_uv).rgb * u_bloom_intensity;
+    // Exponential tonemapping: linear for dark colors, and never saturates abruptly
+    out_color = vec4(vec3(1.) - exp(-color * u_exposure), 1.);
+}
@@ -0,0 +1,11 @@
+#version 410
+in vec2 v_uv;
+out vec4 out_color;
+uniform sampler2D u_image;
+uniform sampler2D u_previous;
+uniform float u_persistence;
+
+void main()
+{
+    out_color = vec4(texture(u_image, v_uv).rgb + texture(u_previous, v_uv).rgb * u_persistence, 1.);
+}
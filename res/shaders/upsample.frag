@@ -0,0 +1,20 @@
+#version 410
+in vec2 v_uv;
+out vec4 out_color;
+uniform sampler2D u_image;
+uniform vec2 u_texel_size; // Of the source image
+
+void main()
+{
+    // 3x3 tent filter, to hide the blocky look of the smaller levels
+    vec3 color = texture(u_image, v_uv).rgb * 4.
+               + (texture(u_image, v_uv + u_texel_size * vec2(-1., 0.)).rgb
+                + texture(u_image, v_uv + u_texel_size * vec2(+1., 0.)).rgb
+                + texture(u_image, v_uv + u_texel_size * vec2(0., -1.)).rgb
+                + texture(u_image, v_uv + u_texel_size * vec2(0., +1.)).rgb) * 2.
+               + texture(u_image, v_uv + u_texel_size * vec2(-1., -1.)).rgb
+               + texture(u_image, v_uv + u_texel_size * vec2(+1., -1.)).rgb
+               + texture(u_image, v_uv + u_texel_size * vec2(-1., +1.)).rgb
+               + texture(u_image, v_uv + u_texel_size * vec2(+1., +1.)).rgb;
+    out_color = vec4(color / 16., 1.);
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+struct Line {
+    glm::vec2 p1, p2;
+};
+
+struct Circle {
+    glm::vec2 center;
+    float radius;
+};
+
+// Static geometry the particles collide with
+struct Obstacles {
+    std::vector<Line> lines;
+    std::vector<Circle> circles;
+};
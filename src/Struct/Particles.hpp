@@ -1,7 +1,9 @@
+#pragma once
 #include <iostream>
 #include <cstdlib>
 #include <ctime>
 #include "utils.hpp"
+#include "opengl-framework/opengl-framework.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 #include <cmath>
@@ -157,14 +159,23 @@ struct Particle {
 
     // Radius that linearly shrinks to 0 at end of life
     float radius() const {
+        return radius_at(startRadius, lifetime, age);
+    }
+
+    glm::vec4 color() const {
+        return color_at(startColor, endColor, glm::clamp(age / lifetime, 0.f, 1.f));
+    }
+
+    // Same as radius() and color(), for the particles that are not stored as a Particle (see packed_particles.hpp)
+    static float radius_at(float startRadius, float lifetime, float age) {
         float fade = std::clamp((2.0f - (lifetime - age)) / 2.0f, 0.f, 1.f); // 0 si plus de 2 sec restantes, 1 si mort imminente
         float bounce = std::abs(std::sin(10.f * fade * glm::pi<float>()) * (1.f - fade));
         return startRadius * (1.0f - fade) + 0.005f * bounce;
     }
 
-    glm::vec4 color() const {
+    // t is age / lifetime, in [0, 1]
+    static glm::vec4 color_at(glm::vec4 const& startColor, glm::vec4 const& endColor, float t) {
         float p = 3.f;
-        float t = glm::clamp(age / lifetime, 0.f, 1.f);
         float left = std::pow(glm::min(2.f * t, 1.f), p);
         float right = std::pow(glm::min(2.f * (1.f - t), 1.f), p);
         float easedT = 0.5f * (left + (2.f - right));
@@ -0,0 +1,57 @@
+#include "allocations.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(PARTICLES_COUNT_ALLOCATIONS)
+
+namespace {
+
+std::atomic<size_t> allocationsCount{0};
+
+void* allocate(size_t size, size_t alignment)
+{
+    allocationsCount.fetch_add(1, std::memory_order_relaxed);
+    size = size == 0 ? 1 : size;
+#if defined(_WIN32)
+    void* const ptr = _aligned_malloc(size, alignment);
+#else
+    void* const ptr = alignment <= alignof(std::max_align_t)
+                          ? std::malloc(size)
+                          : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+    if (ptr == nullptr)
+        throw std::bad_alloc{};
+    return ptr;
+}
+
+void release(void* ptr)
+{
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+} // namespace
+
+// The array, sized and nothrow versions of the standard library all forward to these ones
+void* operator new(size_t size) { return allocate(size, alignof(std::max_align_t)); }
+void* operator new(size_t size, std::align_val_t alignment) { return allocate(size, static_cast<size_t>(alignment)); }
+void  operator delete(void* ptr) noexcept { release(ptr); }
+void  operator delete(void* ptr, std::align_val_t) noexcept { release(ptr); }
+void  operator delete(void* ptr, size_t) noexcept { release(ptr); }
+void  operator delete(void* ptr, size_t, std::align_val_t) noexcept { release(ptr); }
+
+namespace allocations {
+size_t count() { return allocationsCount.load(std::memory_order_relaxed); }
+} // namespace allocations
+
+#else
+
+namespace allocations {
+size_t count() { return 0; }
+} // namespace allocations
+
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstddef>
+
+// Counts the calls to the global operator new of the whole program, to check that once everything has warmed up a frame never touches the heap.
+// Only active when compiled with the PARTICLES_COUNT_ALLOCATIONS CMake option: count() always returns 0 otherwise.
+namespace allocations {
+
+#if defined(PARTICLES_COUNT_ALLOCATIONS)
+inline constexpr bool isCounting = true;
+#else
+inline constexpr bool isCounting = false;
+#endif
+
+// Number of allocations since the start of the program, from all the threads
+size_t count();
+
+} // namespace allocations
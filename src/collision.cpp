@@ -0,0 +1,249 @@
+#include "collision.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace collision {
+
+// p1 + (t * r) = q1 + (u * s)
+bool intersect_segments(glm::vec2 p1, glm::vec2 p2, glm::vec2 q1, glm::vec2 q2, glm::vec2& intersection)
+{
+    // ------ Calcul des vecteur directeur ------
+    glm::vec2 r = p2 - p1; // Vecteur directeur du segment p (calculée avec les extrémités p1 et p2 du segment p)
+    glm::vec2 s = q2 - q1; // Vecteur directeur du segment q (calculée avec les extrémités q1 et q2 du segment q)
+
+    // ------ Calcul du déterminant ------
+    glm::mat2x2 m{ r, -s }; // Matrice formée par les vecteurs r et -s
+    glm::vec2 t = glm::inverse(m) * (q1-p1);
+
+    // ------ Vérification de si le point sur l'intersection est dans les segments ------
+    if (t.x >= 0 && t.x <= 1 && t.y >= 0 && t.y <= 1) {
+        intersection = p1 + t.x * r;
+        return true;
+    }
+
+    return false;
+}
+
+bool intersect_segment_circle(glm::vec2 p0, glm::vec2 p1, glm::vec2 center, float radius, glm::vec2& intersection)
+{
+    glm::vec2 d = p1 - p0;
+    glm::vec2 f = p0 - center;
+
+    float a = glm::dot(d, d);
+    float b = 2.f * glm::dot(f, d);
+    float c = glm::dot(f, f) - radius * radius;
+
+    float discriminant = b * b - 4 * a * c;
+
+    if (discriminant < 0) {
+        // Pas d'intersection
+        return false;
+    } else {
+        discriminant = std::sqrt(discriminant);
+
+        // Trouver les deux solutions possibles
+        float t1 = (-b - discriminant) / (2 * a);
+        float t2 = (-b + discriminant) / (2 * a);
+
+        // Vérifier si une solution est dans le segment
+        if (t1 >= 0.f && t1 <= 1.f) {
+            intersection = p0 + t1 * d;
+            return true;
+        }
+
+        if (t2 >= 0.f && t2 <= 1.f) {
+            intersection = p0 + t2 * d;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+glm::vec2 closest_point_on_segment(glm::vec2 point, glm::vec2 a, glm::vec2 b)
+{
+    glm::vec2 ab = b - a;
+    float lengthSquared = glm::dot(ab, ab);
+    if (lengthSquared == 0.f)
+        return a;
+    float t = glm::clamp(glm::dot(point - a, ab) / lengthSquared, 0.f, 1.f);
+    return a + t * ab;
+}
+
+bool bounding_box(Obstacles const& obstacles, glm::vec2& min, glm::vec2& max)
+{
+    if (obstacles.lines.empty() && obstacles.circles.empty())
+        return false;
+
+    min = glm::vec2{std::numeric_limits<float>::max()};
+    max = glm::vec2{std::numeric_limits<float>::lowest()};
+    for (const auto& line : obstacles.lines) {
+        min = glm::min(min, glm::min(line.p1, line.p2));
+        max = glm::max(max, glm::max(line.p1, line.p2));
+    }
+    for (const auto& circle : obstacles.circles) {
+        min = glm::min(min, circle.center - circle.radius);
+        max = glm::max(max, circle.center + circle.radius);
+    }
+    return true;
+}
+
+static float cross(glm::vec2 a, glm::vec2 b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+bool time_of_impact(glm::vec2 p0, glm::vec2 p1, Line const& line, Hit& hit)
+{
+    glm::vec2 const r = p1 - p0;
+    glm::vec2 const s = line.p2 - line.p1;
+    float const denominator = cross(r, s);
+    if (std::abs(denominator) < 1e-12f)
+        return false; // Parallel
+
+    glm::vec2 const toLine = line.p1 - p0;
+    float const t = cross(toLine, s) / denominator;
+    float const u = cross(toLine, r) / denominator;
+    if (t < 0.f || t > 1.f || u < 0.f || u > 1.f)
+        return false;
+
+    glm::vec2 normal = glm::normalize(glm::vec2(-s.y, s.x));
+    if (glm::dot(normal, p0 - line.p1) < 0.f)
+        normal = -normal;
+    hit = Hit{t, p0 + t * r, normal};
+    return true;
+}
+
+bool time_of_impact(glm::vec2 p0, glm::vec2 p1, Circle const& circle, Hit& hit)
+{
+    glm::vec2 const d = p1 - p0;
+    glm::vec2 const f = p0 - circle.center;
+
+    float const a = glm::dot(d, d);
+    if (a < 1e-12f)
+        return false;
+    float const b = 2.f * glm::dot(f, d);
+    float const c = glm::dot(f, f) - circle.radius * circle.radius;
+    float const discriminant = b * b - 4.f * a * c;
+    if (discriminant < 0.f)
+        return false;
+
+    // Entering the circle from outside hits the first root, leaving it from inside hits the second one
+    bool const startsInside = c < 0.f;
+    float const root = std::sqrt(discriminant);
+    float const t = startsInside ? (-b + root) / (2.f * a) : (-b - root) / (2.f * a);
+    if (t < 0.f || t > 1.f)
+        return false;
+
+    glm::vec2 const point = p0 + t * d;
+    glm::vec2 const outward = (point - circle.center) / circle.radius;
+    hit = Hit{t, point, startsInside ? -outward : outward};
+    return true;
+}
+
+Broadphase::Broadphase(Obstacles const& obstacles, float cellSize)
+    : _cellSize{cellSize}
+{
+    if (!bounding_box(obstacles, _min, _max))
+        return;
+    _resolution = glm::clamp(glm::ivec2{glm::ceil((_max - _min) / _cellSize)}, glm::ivec2{1}, glm::ivec2{512});
+
+    auto const for_each_cell = [&](glm::vec2 boxMin, glm::vec2 boxMax, auto&& callback) {
+        glm::ivec2 const first = cell_of(boxMin);
+        glm::ivec2 const last  = cell_of(boxMax);
+        for (int y = first.y; y <= last.y; ++y)
+            for (int x = first.x; x <= last.x; ++x)
+                callback(static_cast<size_t>(x + y * _resolution.x));
+    };
+    auto const for_each_item = [&](auto&& callback) {
+        for (uint32_t i = 0; i < obstacles.lines.size(); ++i) {
+            Line const& line = obstacles.lines[i];
+            for_each_cell(glm::min(line.p1, line.p2), glm::max(line.p1, line.p2), [&](size_t cell) { callback(cell, i); });
+        }
+        for (uint32_t i = 0; i < obstacles.circles.size(); ++i) {
+            Circle const& circle = obstacles.circles[i];
+            for_each_cell(circle.center - circle.radius, circle.center + circle.radius, [&](size_t cell) { callback(cell, i | circleBit); });
+        }
+    };
+
+    // Count, then fill
+    _cellStarts.assign(static_cast<size_t>(_resolution.x * _resolution.y) + 1, 0);
+    for_each_item([&](size_t cell, uint32_t) { _cellStarts[cell + 1]++; });
+    for (size_t i = 1; i < _cellStarts.size(); ++i)
+        _cellStarts[i] += _cellStarts[i - 1];
+    _items.resize(_cellStarts.back());
+    std::vector<uint32_t> cursors(_cellStarts.begin(), _cellStarts.end() - 1);
+    for_each_item([&](size_t cell, uint32_t item) { _items[cursors[cell]++] = item; });
+}
+
+Broadphase::Broadphase(glm::vec2 min, glm::vec2 max, float cellSize, glm::ivec2 resolution, std::vector<uint32_t> cellStarts, std::vector<uint32_t> items)
+    : _min{min}
+    , _max{max}
+    , _cellSize{cellSize}
+    , _resolution{resolution}
+    , _cellStarts{std::move(cellStarts)}
+    , _items{std::move(items)}
+{
+    assert(_cellStarts.empty() || _cellStarts.size() == static_cast<size_t>(_resolution.x * _resolution.y) + 1);
+}
+
+bool Broadphase::is_valid(size_t linesCount, size_t circlesCount) const
+{
+    if (_cellStarts.empty())
+        return _items.empty();
+    if (_resolution.x <= 0 || _resolution.y <= 0 || _cellStarts.size() != static_cast<size_t>(_resolution.x) * static_cast<size_t>(_resolution.y) + 1)
+        return false;
+    if (_cellStarts.front() != 0 || _cellStarts.back() != _items.size() || !std::is_sorted(_cellStarts.begin(), _cellStarts.end()))
+        return false;
+    return std::all_of(_items.begin(), _items.end(), [&](uint32_t item) {
+        return (item & circleBit) ? (item & ~circleBit) < circlesCount : item < linesCount;
+    });
+}
+
+glm::ivec2 Broadphase::cell_of(glm::vec2 position) const
+{
+    return glm::clamp(glm::ivec2{glm::floor((position - _min) / _cellSize)}, glm::ivec2{0}, _resolution - 1);
+}
+
+void move_particle(glm::vec2& position, glm::vec2& velocity, float dt, Obstacles const& obstacles, Broadphase const& broadphase, int maxBounces)
+{
+    // Distance kept between the particle and the surface it bounced on, so that the next motion doesn't start exactly on it
+    constexpr float surfaceOffset = 1e-5f;
+
+    glm::vec2 displacement = velocity * dt;
+    for (int bounce = 1;; ++bounce) {
+        glm::vec2 const target = position + displacement;
+
+        Hit earliest{2.f, {}, {}};
+        broadphase.for_each_candidate(
+            position, target,
+            [&](uint32_t i) {
+                Hit hit;
+                if (time_of_impact(position, target, obstacles.lines[i], hit) && hit.time < earliest.time)
+                    earliest = hit;
+            },
+            [&](uint32_t i) {
+                Hit hit;
+                if (time_of_impact(position, target, obstacles.circles[i], hit) && hit.time < earliest.time)
+                    earliest = hit;
+            }
+        );
+
+        if (earliest.time > 1.f) {
+            position = target;
+            return;
+        }
+
+        // Resolve the impact, then keep going with what is left of the motion
+        position = earliest.point + earliest.normal * surfaceOffset;
+        velocity = glm::reflect(velocity, earliest.normal);
+        if (bounce >= maxBounces)
+            return; // The rest of the motion is dropped: the particle waits at its last impact and leaves along the reflected velocity next step
+        displacement = glm::reflect(displacement, earliest.normal) * (1.f - earliest.time);
+    }
+}
+
+} // namespace collision
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Struct/Obstacles.hpp"
+
+namespace collision {
+
+// p1 + (t * r) = q1 + (u * s)
+bool intersect_segments(glm::vec2 p1, glm::vec2 p2, glm::vec2 q1, glm::vec2 q2, glm::vec2& intersection);
+bool intersect_segment_circle(glm::vec2 p0, glm::vec2 p1, glm::vec2 center, float radius, glm::vec2& intersection);
+glm::vec2 closest_point_on_segment(glm::vec2 point, glm::vec2 a, glm::vec2 b);
+
+// Bounding box of all the obstacles. Returns false if there are none.
+bool bounding_box(Obstacles const& obstacles, glm::vec2& min, glm::vec2& max);
+
+// Time of impact of a motion from p0 to p1 against an obstacle
+struct Hit {
+    float     time;   // In [0, 1], fraction of the motion done before the impact
+    glm::vec2 point;
+    glm::vec2 normal; // Points towards the side the motion comes from
+};
+
+bool time_of_impact(glm::vec2 p0, glm::vec2 p1, Line const& line, Hit& hit);
+bool time_of_impact(glm::vec2 p0, glm::vec2 p1, Circle const& circle, Hit& hit);
+
+// Uniform grid over the obstacles, so that a motion is only tested against the obstacles it can reach
+class Broadphase {
+public:
+    Broadphase() = default;
+    Broadphase(Obstacles const& obstacles, float cellSize);
+    // Rebuilds a grid from its raw representation (see the accessors below), e.g. when loading it back from a file
+    Broadphase(glm::vec2 min, glm::vec2 max, float cellSize, glm::ivec2 resolution, std::vector<uint32_t> cellStarts, std::vector<uint32_t> items);
+
+    // Calls on_line(index) / on_circle(index) for every obstacle whose cells overlap the bounding box of the motion from p0 to p1.
+    // An obstacle can be reported several times (once per cell it covers).
+    template<typename OnLine, typename OnCircle>
+    void for_each_candidate(glm::vec2 p0, glm::vec2 p1, OnLine&& on_line, OnCircle&& on_circle) const
+    {
+        if (_cellStarts.empty())
+            return;
+        glm::vec2 const boxMin = glm::min(p0, p1);
+        glm::vec2 const boxMax = glm::max(p0, p1);
+        if (glm::any(glm::greaterThan(boxMin, _max)) || glm::any(glm::lessThan(boxMax, _min)))
+            return; // Every obstacle is inside [_min, _max]
+        glm::ivec2 const first = cell_of(boxMin);
+        glm::ivec2 const last  = cell_of(boxMax);
+        for (int y = first.y; y <= last.y; ++y) {
+            for (int x = first.x; x <= last.x; ++x) {
+                auto const cell = static_cast<size_t>(x + y * _resolution.x);
+                for (uint32_t k = _cellStarts[cell]; k < _cellStarts[cell + 1]; ++k) {
+                    uint32_t const item = _items[k];
+                    if (item & circleBit)
+                        on_circle(item & ~circleBit);
+                    else
+                        on_line(item);
+                }
+            }
+        }
+    }
+
+    // Checks that the cells are consistent ranges of items, and that the items only refer to existing obstacles,
+    // e.g. after rebuilding the grid from a file that may be corrupted
+    bool is_valid(size_t linesCount, size_t circlesCount) const;
+
+    glm::vec2                 min() const { return _min; }
+    glm::vec2                 max() const { return _max; }
+    float                     cell_size() const { return _cellSize; }
+    glm::ivec2                resolution() const { return _resolution; }
+    std::span<uint32_t const> cell_starts() const { return _cellStarts; }
+    std::span<uint32_t const> items() const { return _items; }
+
+private:
+    glm::ivec2 cell_of(glm::vec2 position) const;
+
+private:
+    static constexpr uint32_t circleBit = 1u << 31;
+
+    glm::vec2             _min{0.f};
+    glm::vec2             _max{0.f};
+    float                 _cellSize{1.f};
+    glm::ivec2            _resolution{0};
+    std::vector<uint32_t> _cellStarts{}; // size: cells count + 1
+    std::vector<uint32_t> _items{};      // Line indices, or circle indices with circleBit set
+};
+
+// Moves a particle by velocity * dt, bouncing on the earliest obstacle hit and continuing with the remaining distance, up to maxBounces times.
+// If the bounce cap is reached the particle stops at its last impact, so it can never end up on the other side of an obstacle.
+void move_particle(glm::vec2& position, glm::vec2& velocity, float dt, Obstacles const& obstacles, Broadphase const& broadphase, int maxBounces = 4);
+
+} // namespace collision
@@ -0,0 +1,269 @@
+#include "distance_field.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include "collision.hpp"
+#include "parallel.hpp"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace collision {
+
+// Value of the cells that are not close to any obstacle (only happens when there are no obstacles at all)
+static constexpr float farAway = 1e6f;
+
+DistanceField::DistanceField(Obstacles const& obstacles, float cellSize, float margin)
+{
+    glm::vec2 min{-1.f};
+    glm::vec2 max{1.f};
+    bounding_box(obstacles, min, max);
+    *this = DistanceField{obstacles, min - margin, max + margin, cellSize};
+}
+
+DistanceField::DistanceField(Obstacles const& obstacles, glm::vec2 min, glm::vec2 max, float cellSize)
+    : _min{min}
+    , _cellSize{cellSize}
+    , _lineThickness{cellSize} // Thinner lines could fall between two samples and be invisible to the bilinear interpolation
+    , _resolution{glm::max(glm::ivec2{glm::ceil((max - min) / cellSize)}, glm::ivec2{2})}
+{
+    bake(obstacles);
+}
+
+void DistanceField::bake(Obstacles const& obstacles)
+{
+    auto const linesCount = static_cast<int32_t>(obstacles.lines.size());
+    auto const signed_distance = [&](int32_t obstacle, glm::vec2 position) {
+        if (obstacle < linesCount) {
+            Line const& line = obstacles.lines[static_cast<size_t>(obstacle)];
+            return glm::distance(position, closest_point_on_segment(position, line.p1, line.p2)) - 0.5f * _lineThickness;
+        }
+        Circle const& circle = obstacles.circles[static_cast<size_t>(obstacle - linesCount)];
+        return glm::distance(position, circle.center) - circle.radius;
+    };
+    auto const cell_center = [&](int x, int y) {
+        return _min + (glm::vec2{static_cast<float>(x), static_cast<float>(y)} + 0.5f) * _cellSize;
+    };
+
+    size_t const cellsCount = static_cast<size_t>(_resolution.x * _resolution.y);
+    _distances.assign(cellsCount, farAway);
+    std::vector<int32_t> nearest(cellsCount, -1); // Obstacle that gives the distance of each cell: lines first, then circles
+
+    // 1. Exact distances in a band around each obstacle (one row per job, so that no two jobs write the same cell)
+    float const band = 2.f * _cellSize;
+    parallel::for_each_index(static_cast<size_t>(_resolution.y), [&](size_t row) {
+        int const y = static_cast<int>(row);
+        float const rowY = cell_center(0, y).y;
+        auto const rasterize = [&](int32_t obstacle, glm::vec2 boxMin, glm::vec2 boxMax) {
+            if (rowY < boxMin.y - band || rowY > boxMax.y + band)
+                return;
+            int const firstX = std::max(0, static_cast<int>(std::floor((boxMin.x - band - _min.x) / _cellSize)));
+            int const lastX = std::min(_resolution.x - 1, static_cast<int>(std::ceil((boxMax.x + band - _min.x) / _cellSize)));
+            for (int x = firstX; x <= lastX; ++x) {
+                auto const cell = static_cast<size_t>(x + y * _resolution.x);
+                float const distance = signed_distance(obstacle, cell_center(x, y));
+                if (distance < _distances[cell]) {
+                    _distances[cell] = distance;
+                    nearest[cell] = obstacle;
+                }
+            }
+        };
+        for (int32_t i = 0; i < linesCount; ++i) {
+            Line const& line = obstacles.lines[static_cast<size_t>(i)];
+            rasterize(i, glm::min(line.p1, line.p2), glm::max(line.p1, line.p2));
+        }
+        for (size_t i = 0; i < obstacles.circles.size(); ++i) {
+            Circle const& circle = obstacles.circles[i];
+            rasterize(linesCount + static_cast<int32_t>(i), circle.center - circle.radius, circle.center + circle.radius);
+        }
+    }, 1);
+
+    // 2. Everywhere else, propagate the nearest obstacle of the neighbors with a forward and a backward sweep, and evaluate it exactly
+    auto const propagate = [&](int x, int y, std::array<glm::ivec2, 4> const& offsets) {
+        auto const cell = static_cast<size_t>(x + y * _resolution.x);
+        for (glm::ivec2 const offset : offsets) {
+            int const nx = x + offset.x;
+            int const ny = y + offset.y;
+            if (nx < 0 || ny < 0 || nx >= _resolution.x || ny >= _resolution.y)
+                continue;
+            int32_t const candidate = nearest[static_cast<size_t>(nx + ny * _resolution.x)];
+            if (candidate < 0 || candidate == nearest[cell])
+                continue;
+            float const distance = signed_distance(candidate, cell_center(x, y));
+            if (distance < _distances[cell]) {
+                _distances[cell] = distance;
+                nearest[cell] = candidate;
+            }
+        }
+    };
+    std::array<glm::ivec2, 4> const forward{glm::ivec2{-1, 0}, glm::ivec2{-1, -1}, glm::ivec2{0, -1}, glm::ivec2{1, -1}};
+    std::array<glm::ivec2, 4> const backward{glm::ivec2{1, 0}, glm::ivec2{1, 1}, glm::ivec2{0, 1}, glm::ivec2{-1, 1}};
+    for (int y = 0; y < _resolution.y; ++y)
+        for (int x = 0; x < _resolution.x; ++x)
+            propagate(x, y, forward);
+    for (int y = _resolution.y - 1; y >= 0; --y)
+        for (int x = _resolution.x - 1; x >= 0; --x)
+            propagate(x, y, backward);
+}
+
+float DistanceField::sample(glm::vec2 position) const
+{
+    glm::vec2 gradient;
+    return sample(position, gradient);
+}
+
+float DistanceField::sample(glm::vec2 position, glm::vec2& gradient) const
+{
+    if (_distances.empty()) {
+        gradient = glm::vec2{0.f};
+        return farAway;
+    }
+
+    // Samples are at the center of the cells
+    glm::vec2 const gridPos = glm::clamp((position - _min) / _cellSize - 0.5f, glm::vec2{0.f}, glm::vec2{_resolution - 1});
+    glm::ivec2 const cell = glm::min(glm::ivec2{gridPos}, _resolution - 2);
+    glm::vec2 const f = gridPos - glm::vec2{cell};
+
+    float const d00 = at(cell.x, cell.y);
+    float const d10 = at(cell.x + 1, cell.y);
+    float const d01 = at(cell.x, cell.y + 1);
+    float const d11 = at(cell.x + 1, cell.y + 1);
+
+    gradient = glm::vec2{
+        (d10 - d00) * (1.f - f.y) + (d11 - d01) * f.y,
+        (d01 - d00) * (1.f - f.x) + (d11 - d10) * f.x,
+    } / _cellSize;
+    return glm::mix(glm::mix(d00, d10, f.x), glm::mix(d01, d11, f.x), f.y);
+}
+
+void DistanceField::sample(std::span<glm::vec2 const> positions, std::span<float> distances, std::span<glm::vec2> gradients) const
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    if (!_distances.empty()) {
+        float const* const xs = &positions.data()->x;
+        __m256i const xOffsets = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14); // glm::vec2 are (x, y) pairs
+        __m256 const minX = _mm256_set1_ps(_min.x);
+        __m256 const minY = _mm256_set1_ps(_min.y);
+        __m256 const inverseCellSize = _mm256_set1_ps(1.f / _cellSize);
+        __m256 const half = _mm256_set1_ps(0.5f);
+        __m256 const one = _mm256_set1_ps(1.f);
+        __m256 const zero = _mm256_setzero_ps();
+        __m256 const maxX = _mm256_set1_ps(static_cast<float>(_resolution.x - 1));
+        __m256 const maxY = _mm256_set1_ps(static_cast<float>(_resolution.y - 1));
+        __m256i const lastCellX = _mm256_set1_epi32(_resolution.x - 2);
+        __m256i const lastCellY = _mm256_set1_epi32(_resolution.y - 2);
+        __m256i const rowStride = _mm256_set1_epi32(_resolution.x);
+        __m256i const oneCell = _mm256_set1_epi32(1);
+
+        alignas(32) std::array<float, 8> gradientX;
+        alignas(32) std::array<float, 8> gradientY;
+        for (; i + 8 <= positions.size(); i += 8) {
+            __m256 const x = _mm256_i32gather_ps(xs + 2 * i, xOffsets, 4);
+            __m256 const y = _mm256_i32gather_ps(xs + 2 * i + 1, xOffsets, 4);
+
+            __m256 const gx = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(x, minX), inverseCellSize), half), zero), maxX);
+            __m256 const gy = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_mul_ps(_mm256_sub_ps(y, minY), inverseCellSize), half), zero), maxY);
+            __m256i const cx = _mm256_min_epi32(_mm256_cvttps_epi32(gx), lastCellX);
+            __m256i const cy = _mm256_min_epi32(_mm256_cvttps_epi32(gy), lastCellY);
+            __m256 const fx = _mm256_sub_ps(gx, _mm256_cvtepi32_ps(cx));
+            __m256 const fy = _mm256_sub_ps(gy, _mm256_cvtepi32_ps(cy));
+
+            __m256i const index00 = _mm256_add_epi32(cx, _mm256_mullo_epi32(cy, rowStride));
+            __m256i const index01 = _mm256_add_epi32(index00, rowStride);
+            __m256 const d00 = _mm256_i32gather_ps(_distances.data(), index00, 4);
+            __m256 const d10 = _mm256_i32gather_ps(_distances.data(), _mm256_add_epi32(index00, oneCell), 4);
+            __m256 const d01 = _mm256_i32gather_ps(_distances.data(), index01, 4);
+            __m256 const d11 = _mm256_i32gather_ps(_distances.data(), _mm256_add_epi32(index01, oneCell), 4);
+
+            __m256 const bottom = _mm256_add_ps(d00, _mm256_mul_ps(fx, _mm256_sub_ps(d10, d00)));
+            __m256 const top = _mm256_add_ps(d01, _mm256_mul_ps(fx, _mm256_sub_ps(d11, d01)));
+            _mm256_storeu_ps(distances.data() + i, _mm256_add_ps(bottom, _mm256_mul_ps(fy, _mm256_sub_ps(top, bottom))));
+
+            __m256 const dx = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(d10, d00), _mm256_sub_ps(one, fy)), _mm256_mul_ps(_mm256_sub_ps(d11, d01), fy));
+            __m256 const dy = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(d01, d00), _mm256_sub_ps(one, fx)), _mm256_mul_ps(_mm256_sub_ps(d11, d10), fx));
+            _mm256_store_ps(gradientX.data(), _mm256_mul_ps(dx, inverseCellSize));
+            _mm256_store_ps(gradientY.data(), _mm256_mul_ps(dy, inverseCellSize));
+            for (size_t k = 0; k < 8; ++k)
+                gradients[i + k] = glm::vec2{gradientX[k], gradientY[k]};
+        }
+    }
+#endif
+    for (; i < positions.size(); ++i)
+        distances[i] = sample(positions[i], gradients[i]);
+}
+
+gl::Texture DistanceField::make_texture() const
+{
+    return gl::Texture{
+        gl::TextureSource::Pixels{
+            .pixels               = std::span<uint8_t const>{reinterpret_cast<uint8_t const*>(_distances.data()), _distances.size() * sizeof(float)},
+            .width                = _resolution.x,
+            .height               = _resolution.y,
+            .source_pixels_type   = gl::Type::Float,
+            .source_pixels_format = gl::Format::R,
+            .texture_format       = gl::InternalFormat::R32F,
+        },
+    };
+}
+
+void move_particle(glm::vec2& position, glm::vec2& velocity, float dt, DistanceField const& field, int maxBounces)
+{
+    float remaining = glm::length(velocity) * dt;
+    if (remaining <= 0.f)
+        return;
+    glm::vec2 direction = glm::normalize(velocity);
+
+    // Below this distance we consider that we touch the surface. It also is the smallest step we take, so that we always make progress.
+    float const contactDistance = 0.05f * field.cell_size();
+    // Each step advances by at least contactDistance (or by all that remains), so this is always enough steps to travel the whole motion.
+    // The bound on the ratio only guards against infinite velocities.
+    int const maxSteps = static_cast<int>(std::min(std::ceil(remaining / contactDistance), 1e6f)) + 1;
+    int bounces = 0;
+    for (int step = 0; step < maxSteps && remaining > 0.f; ++step) {
+        glm::vec2 gradient;
+        float const distance = field.sample(position, gradient);
+        if (distance < contactDistance) {
+            glm::vec2 const normal = glm::dot(gradient, gradient) > 0.f ? glm::normalize(gradient) : -direction;
+            if (distance < 0.f)
+                position += normal * (contactDistance - distance); // We are inside: get out first
+            if (glm::dot(direction, normal) < 0.f) {
+                velocity = glm::reflect(velocity, normal);
+                if (++bounces >= maxBounces)
+                    return; // Same as the analytic backend: the rest of the motion is dropped, the particle leaves along the reflected velocity next step
+                direction = glm::reflect(direction, normal);
+            }
+        }
+        // Nothing is closer than distance, so we can safely move that far
+        float const advance = std::min(remaining, std::max(distance, contactDistance));
+        position += direction * advance;
+        remaining -= advance;
+    }
+}
+
+void move_particles(std::span<Particle> particles, float dt, DistanceField const& field, int maxBounces)
+{
+    parallel::for_each_chunk(particles.size(), [&](size_t begin, size_t end) {
+        constexpr size_t batchSize = 256;
+        std::array<glm::vec2, batchSize> positions;
+        std::array<float, batchSize>     distances;
+        std::array<glm::vec2, batchSize> gradients;
+        for (size_t batchBegin = begin; batchBegin < end; batchBegin += batchSize) {
+            size_t const count = std::min(batchSize, end - batchBegin);
+            for (size_t k = 0; k < count; ++k)
+                positions[k] = particles[batchBegin + k].position;
+            field.sample({positions.data(), count}, {distances.data(), count}, {gradients.data(), count});
+
+            for (size_t k = 0; k < count; ++k) {
+                Particle& particle = particles[batchBegin + k];
+                glm::vec2 const motion = particle.velocity * dt;
+                if (glm::dot(motion, motion) < distances[k] * distances[k] && distances[k] > 0.f)
+                    particle.position += motion; // Free space all around: can't hit anything
+                else
+                    move_particle(particle.position, particle.velocity, dt, field, maxBounces);
+            }
+        }
+    });
+}
+
+} // namespace collision
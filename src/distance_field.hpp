@@ -0,0 +1,54 @@
+#pragma once
+#include <span>
+#include <vector>
+#include "glm/glm.hpp"
+#include "opengl-framework/opengl-framework.hpp"
+#include "Struct/Obstacles.hpp"
+#include "Struct/Particles.hpp"
+
+namespace collision {
+
+// Signed distance to the obstacles, baked on a regular grid (negative inside the circles and within lineThickness / 2 of the lines).
+// Colliding against it costs a few lookups per particle, whatever the number of obstacles.
+class DistanceField {
+public:
+    DistanceField() = default;
+    // Covers the bounding box of the obstacles, plus margin on each side
+    DistanceField(Obstacles const& obstacles, float cellSize, float margin = 0.1f);
+    DistanceField(Obstacles const& obstacles, glm::vec2 min, glm::vec2 max, float cellSize);
+
+    // Recomputes the field after the obstacles changed. Keeps the same bounds and resolution.
+    void bake(Obstacles const& obstacles);
+
+    // Bilinear interpolation of the field. Positions outside the grid are clamped to its border.
+    float sample(glm::vec2 position) const;
+    float sample(glm::vec2 position, glm::vec2& gradient) const;
+    // Same as above for many positions at once. Uses AVX2 gathers when compiled with PARTICLES_ENABLE_AVX2.
+    void sample(std::span<glm::vec2 const> positions, std::span<float> distances, std::span<glm::vec2> gradients) const;
+
+    // R32F texture of the field, e.g. to sample it in a shader
+    gl::Texture make_texture() const;
+
+    glm::ivec2 resolution() const { return _resolution; }
+    glm::vec2  min() const { return _min; }
+    float      cell_size() const { return _cellSize; }
+    float      line_thickness() const { return _lineThickness; }
+
+private:
+    float at(int x, int y) const { return _distances[static_cast<size_t>(x + y * _resolution.x)]; }
+
+private:
+    glm::vec2          _min{0.f};
+    float              _cellSize{1.f};
+    float              _lineThickness{0.f};
+    glm::ivec2         _resolution{0};
+    std::vector<float> _distances{};
+};
+
+// Sphere-traces the motion of a particle through the field, bouncing where the distance reaches 0, up to maxBounces times
+void move_particle(glm::vec2& position, glm::vec2& velocity, float dt, DistanceField const& field, int maxBounces = 4);
+
+// Moves all the particles: the ones that are further from any obstacle than the length of their motion are moved directly (one batched lookup each), the others are sphere-traced
+void move_particles(std::span<Particle> particles, float dt, DistanceField const& field, int maxBounces = 4);
+
+} // namespace collision
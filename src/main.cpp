@@ -1,105 +1,99 @@
 #include "opengl-framework/opengl-framework.hpp"
 #include "utils.hpp"
 #include "Struct/Particles.hpp"
+#include "Struct/Obstacles.hpp"
+#include "collision.hpp"
+#include "distance_field.hpp"
+#include "scene_loader.hpp"
+#include "snapshot.hpp"
+#include "replay.hpp"
+#include "sph.hpp"
+#include "pbd.hpp"
+#include "particle_renderer.hpp"
+#include "packed_particles.hpp"
+#include "parallel.hpp"
+#include "allocations.hpp"
+#include "slot_map.hpp"
+#include "render_commands.hpp"
+#include "pipeline.hpp"
+#include "post_processing.hpp"
 #include <vector>
+#include <optional>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <stdexcept>
 #include <cstdlib> // Pour std::rand et std::srand
 #include <ctime>   // Pour std::time
 
+enum class SimulationMode {
+    Ballistic, // Chaque particule avance en ligne droite et rebondit sur les obstacles
+    Fluid,     // Les particules forment un fluide (SPH)
+    Cloth,     // Les particules sont reliées par des contraintes (PBD)
+};
 
-// p1 + (t * r) = q1 + (u * s)
-bool intersect_segments(glm::vec2 p1, glm::vec2 p2, glm::vec2 q1, glm::vec2 q2, glm::vec2& intersection)
-{
-    // ------ Calcul des vecteur directeur ------
-    glm::vec2 r = p2 - p1; // Vecteur directeur du segment p (calculée avec les extrémités p1 et p2 du segment p)
-    glm::vec2 s = q2 - q1; // Vecteur directeur du segment q (calculée avec les extrémités q1 et q2 du segment q)
-    
-    // ------ Calcul du déterminant ------
-    glm::mat2x2 m{ r, -s }; // Matrice formée par les vecteurs r et -s
-    glm::vec2 t = glm::inverse(m) * (q1-p1);
-
-    // ------ Vérification de si le point sur l'intersection est dans les segments ------
-    if (t.x >= 0 && t.x <= 1 && t.y >= 0 && t.y <= 1) {
-        intersection = p1 + t * r;
-        return true;
-    }
+constexpr SimulationMode simulationMode = SimulationMode::Ballistic;
 
-    return false;
-}
+enum class CollisionBackend {
+    Analytic,      // Tests exacts contre chaque ligne / cercle proche
+    DistanceField, // Une lecture dans un champ de distance précalculé, quel que soit le nombre d'obstacles
+};
 
-bool intersect_segment_circle(glm::vec2 p0, glm::vec2 p1, glm::vec2 center, float radius, glm::vec2& intersection)
-{
-    glm::vec2 d = p1 - p0;
-    glm::vec2 f = p0 - center;
+constexpr CollisionBackend collisionBackend = CollisionBackend::Analytic;
 
-    float a = glm::dot(d, d);
-    float b = 2.f * glm::dot(f, d);
-    float c = glm::dot(f, f) - radius * radius;
+// Fichier d'obstacles à charger (voir scene_loader.hpp pour le format), par exemple "res/obstacles.txt". nullptr pour des obstacles aléatoires.
+constexpr const char* obstaclesFile = nullptr;
 
-    float discriminant = b * b - 4 * a * c;
+// Taille des cellules de la grille d'accélération, qui permet de ne tester que les obstacles proches de chaque particule
+constexpr float broadphaseCellSize = 0.1f;
 
-    if (discriminant < 0) {
-        // Pas d'intersection
-        return false;
-    } else {
-        discriminant = std::sqrt(discriminant);
+// Sauvegarde de la simulation (particules + obstacles) : rechargée au lancement si le fichier existe, écrite à la fermeture de la fenêtre.
+// nullptr pour désactiver. Les contraintes du mode Cloth ne sont pas sauvegardées.
+constexpr const char* snapshotFile = nullptr;
+constexpr snapshot::Compression snapshotCompression = snapshot::Compression::None;
 
-        // Trouver les deux solutions possibles
-        float t1 = (-b - discriminant) / (2 * a);
-        float t2 = (-b + discriminant) / (2 * a);
+// Enregistrement image par image de la simulation, pour comparer deux exécutions ou faire un rendu hors ligne. nullptr pour désactiver.
+constexpr const char* replayRecordFile = nullptr;
+// Rejoue un enregistrement au lieu de simuler. nullptr pour simuler.
+constexpr const char* replayPlayFile = nullptr;
 
-        // Vérifier si une solution est dans le segment
-        if (t1 >= 0.f && t1 <= 1.f) {
-            intersection = p0 + t1 * d;
-            return true;
-        }
+// Dossier où enregistrer chaque image affichée en PNG (frame_00000.png, ...). nullptr pour désactiver.
+constexpr const char* captureFolder = nullptr;
 
-        if (t2 >= 0.f && t2 <= 1.f) {
-            intersection = p0 + t2 * d;
-            return true;
-        }
-    }
+// Vidéo non compressée pour un encodeur externe, par exemple "capture.y4m", ou "-" pour la sortie standard
+// (./Particles | ffmpeg -i - video.mp4). Beaucoup plus rapide que les PNG. nullptr pour désactiver.
+constexpr const char* videoFile = nullptr;
+constexpr gl::VideoFormat videoFormat = gl::VideoFormat::Y4M;
 
-    return false;
-}
+// Halo autour des particules lumineuses, traînées et tonemapping. false pour dessiner directement à l'écran.
+constexpr bool postProcessingEnabled = true;
+// Part de l'image précédente qui reste à l'écran à chaque frame (0 = pas de traînées)
+constexpr float trailsPersistence = 0.f;
 
+// Stocke les particules sur 28 octets au lieu de 64 (couleurs en RGBA8, positions en virgule fixe sur 16 bits) :
+// moins de mémoire et de bande passante pour des millions de particules, au prix d'un peu de précision. Mode Ballistic uniquement.
+constexpr bool packedStorage = false;
 
-int main()
-{
-    gl::init("Particules!");
-    gl::maximize_window();
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+// Simule l'image suivante sur un autre thread pendant que celle-ci est dessinée (et pendant l'attente de la synchro verticale),
+// au prix d'une image de latence. false pour tout faire dans la boucle principale.
+constexpr bool pipelinedSimulation = true;
 
-    // --------------------------------------
+// Synchro verticale, et limite d'images par seconde (0 = pas de limite) pour économiser l'énergie quand elle est désactivée
+constexpr gl::VSync vsync = gl::VSync::On;
+constexpr double maxFramesPerSecond = 0.;
+// Affiche régulièrement la durée des images (moyenne lissée et percentiles), pour repérer les saccades
+constexpr bool printFrameTimes = false;
 
-    // // Créer un tableau de particules
-    // std::vector<Particle> particles(200);
-    
-    // --------------------------------------
-
-    // std::vector<Particle> particles;
-    // particles.reserve(200);  // Préallouer pour optimiser
-    
-    // glm::vec2 circleCenter = glm::vec2(0.f, 0.f);
-    // float circleRadius = 0.5f;
-    
-    // for (int i = 0; i < 1000; ++i) {
-    //     particles.emplace_back(circleCenter, circleRadius);
-    // }
-        
-    std::vector<Particle> particles;
-    std::vector<glm::vec2> points = utils::poisson_disc_sampling(glm::vec2(0.f, 0.f), 0.8f, 0.02f);
+// Images utilisées à la place des disques, regroupées dans un atlas. Particule i -> image i % spriteFiles.size().
+// Vide pour dessiner des disques.
+static const std::vector<std::filesystem::path> spriteFiles{};
 
-    for (const glm::vec2& pt : points) {
-        particles.emplace_back(pt);
-    }
+static Obstacles make_random_obstacles()
+{
+    Obstacles obstacles;
 
     // Création de lignes aléatoires
-    struct Line {
-        glm::vec2 p1, p2;
-    };
-
-    std::vector<Line> lines;
+    std::vector<Line>& lines = obstacles.lines;
 
     int lineCount = 3;
     int minimumLineLenght = 1.f;
@@ -130,16 +124,11 @@ int main()
     lines.push_back({bottomLeft, topLeft});
 
     // Création de cercles aléatoires
-    struct Circle {
-        glm::vec2 center;
-        float radius;
-    };
-
     int circleCount = 3;
     float minRadius = 0.1f;
     float maxRadius = 0.2f;
 
-    std::vector<Circle> circles;
+    std::vector<Circle>& circles = obstacles.circles;
 
     for (int i = 0; i < circleCount; ++i) {
         glm::vec2 center = glm::vec2(
@@ -150,6 +139,62 @@ int main()
         circles.push_back({center, radius});
     }
 
+    return obstacles;
+}
+
+int main()
+{
+    gl::init("Particules!");
+    gl::maximize_window();
+    gl::set_vsync(vsync);
+    gl::set_max_frames_per_second(maxFramesPerSecond);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+
+    // --------------------------------------
+
+    // // Créer un tableau de particules
+    // std::vector<Particle> particles(200);
+    
+    // --------------------------------------
+
+    // std::vector<Particle> particles;
+    // particles.reserve(200);  // Préallouer pour optimiser
+    
+    // glm::vec2 circleCenter = glm::vec2(0.f, 0.f);
+    // float circleRadius = 0.5f;
+    
+    // for (int i = 0; i < 1000; ++i) {
+    //     particles.emplace_back(circleCenter, circleRadius);
+    // }
+        
+    std::vector<Particle> particles;
+    std::vector<glm::vec2> points = utils::poisson_disc_sampling(glm::vec2(0.f, 0.f), 0.8f, 0.02f);
+
+    for (const glm::vec2& pt : points) {
+        particles.emplace_back(pt);
+    }
+
+    // Obstacles chargés depuis un fichier, ou générés aléatoirement
+    Obstacles obstacles;
+    collision::Broadphase broadphase;
+    if (obstaclesFile != nullptr) {
+        scene::Scene scene = scene::load_scene(obstaclesFile, broadphaseCellSize);
+        obstacles = std::move(scene.obstacles);
+        broadphase = std::move(scene.broadphase);
+    } else {
+        obstacles = make_random_obstacles();
+        broadphase = collision::Broadphase{obstacles, broadphaseCellSize};
+    }
+
+    // Relatif à l'exécutable, comme obstaclesFile. gl::make_absolute_path() refuse les chemins qui n'existent pas,
+    // d'où le passage par le dossier : le fichier n'existe pas avant la première sauvegarde.
+    const std::filesystem::path snapshotPath = snapshotFile != nullptr ? (gl::make_absolute_path(".") / snapshotFile).lexically_normal() : std::filesystem::path{};
+    if (snapshotFile != nullptr && simulationMode != SimulationMode::Cloth && std::filesystem::exists(snapshotPath)) {
+        snapshot::Snapshot{snapshotPath}.restore(particles, obstacles);
+        broadphase = collision::Broadphase{obstacles, broadphaseCellSize};
+    }
+
     // particles.erase(
     //     std::remove_if(particles.begin(), particles.end(), [&](const Particle& p) {
     //         for (const auto& circle : circles) {
@@ -162,76 +207,278 @@ int main()
     //     particles.end()
     // );
 
-    while (gl::window_is_open())
-    {
-        glClearColor(0.f, 0.f, 0.f, 1.f);
-        glClear(GL_COLOR_BUFFER_BIT);
+    const int maxBouncesPerStep = 4;
 
-        const float dt = gl::delta_time_in_seconds();
+    // À recalculer avec distanceField.bake(obstacles) si les obstacles changent
+    collision::DistanceField distanceField{};
+    if (collisionBackend == CollisionBackend::DistanceField)
+        distanceField = collision::DistanceField{obstacles, 0.01f};
 
-        // Afficher les particules
-        for (auto it = particles.begin(); it != particles.end(); )
-        {
-            it->update(dt);
-
-            glm::vec2 intersection;
-            bool collided = false;
-            glm::vec2 normal;
-
-            glm::vec2 nextPos = it->position + it->velocity * dt;
+    sph::Solver fluid{};
+    pbd::Solver constraints{};
 
-            for (const auto& line : lines) {
-                if (intersect_segments(it->position, nextPos, line.p1, line.p2, intersection)) {
-                    collided = true;
-                    
-                    // Calcul du vecteur directeur de la ligne
-                    glm::vec2 edge = line.p2 - line.p1;
-                    normal = glm::normalize(glm::vec2(-edge.y, edge.x)); // normale perpendiculaire
+    if (simulationMode == SimulationMode::Cloth) {
+        particles.clear();
+        pbd::add_cloth(particles, constraints, glm::vec2(-0.5f, 0.8f), 40, 30, 0.025f);
+        pbd::add_rope(particles, constraints, glm::vec2(0.8f, 0.9f), glm::vec2(1.3f, 0.9f), 30);
+    }
 
-                    // Si la normale ne pointe pas vers la particule, on l'inverse
-                    if (glm::dot(normal, it->velocity) > 0.f)
-                        normal = -normal;
+    // Les positions compressées sont relatives à un carré qui couvre toute la fenêtre, avec une marge
+    const bool usePackedStorage = packedStorage && simulationMode == SimulationMode::Ballistic;
+    const packed::Tile particlesTile = packed::Tile::covering(
+        glm::vec2(-gl::window_aspect_ratio(), -1.f) - 0.1f,
+        glm::vec2(gl::window_aspect_ratio(), 1.f) + 0.1f
+    );
+    std::vector<packed::Particle> packedParticles;
+    if (usePackedStorage) {
+        packedParticles = packed::pack(particles, particlesTile);
+        particles = {}; // Libère la mémoire, les particules ne sont décompressées que par morceaux
+    }
 
-                    break; // première collision ligne trouvée
-                }
+    // Tout ce que la simulation modifie d'une image à l'autre.
+    // Les particules gardent une poignée valide quand d'autres sont supprimées (pour y attacher des traînées, des contraintes...)
+    struct SimulationState {
+        SlotMap<Particle> particles;
+        std::vector<packed::Particle> packedParticles; // Remplace particles avec packedStorage
+        uint32_t frame = 0; // Change l'arrondi aléatoire des particules compressées à chaque image
+    };
+    SimulationState state{SlotMap<Particle>{std::move(particles)}, std::move(packedParticles)};
+    particles = {}; // Ne sert plus qu'à décompresser les particules compressées pour l'enregistrement et la sauvegarde
+
+    std::optional<replay::Recorder> recorder;
+    if (replayRecordFile != nullptr)
+        recorder.emplace(replayRecordFile);
+    std::optional<replay::Player> player;
+    size_t replayFrame = 0;
+    if (replayPlayFile != nullptr)
+        player.emplace(replayPlayFile);
+
+    // Peut tourner sur un autre thread (voir pipelinedSimulation) : aucun appel à OpenGL ici
+    auto simulate = [&](SimulationState& state, float dt) {
+        if (recorder) {
+            if (usePackedStorage) {
+                packed::unpack(state.packedParticles, particlesTile, particles);
+                recorder->record(particles, dt);
+            } else {
+                recorder->record(state.particles.values(), dt);
             }
+        }
 
-            // --- Test collision cercle (uniquement si pas déjà collision ligne) ---
-            if (!collided) {
-                for (const auto& circle : circles) {
-                    if (intersect_segment_circle(it->position, nextPos, circle.center, circle.radius, intersection)) {
-                        collided = true;
-                        normal = glm::normalize(intersection - circle.center);
-                        break;
+        state.frame++;
+        if (usePackedStorage) {
+            // Chaque thread décompresse un petit morceau à la fois, le simule et le recompresse
+            // (Particle::isDead() est toujours faux pour l'instant, donc rien à supprimer)
+            constexpr size_t blockSize = 4096;
+            parallel::for_each_chunk(state.packedParticles.size(), [&](size_t begin, size_t end) {
+                thread_local std::vector<Particle> block;
+                for (size_t blockBegin = begin; blockBegin < end; blockBegin += blockSize) {
+                    auto const packedBlock = std::span{state.packedParticles}.subspan(blockBegin, std::min(blockSize, end - blockBegin));
+                    packed::unpack(packedBlock, particlesTile, block);
+                    for (Particle& particle : block) {
+                        particle.update(dt);
+                        if (collisionBackend == CollisionBackend::Analytic)
+                            collision::move_particle(particle.position, particle.velocity, dt, obstacles, broadphase, maxBouncesPerStep);
+                        else
+                            collision::move_particle(particle.position, particle.velocity, dt, distanceField, maxBouncesPerStep);
                     }
+                    packed::pack(block, particlesTile, packedBlock, state.frame);
                 }
-            }
+            }, blockSize);
+            return;
+        }
 
-            // --- Si collision ---
-            if (collided) {
-                glm::vec2 reflectedVelocity = glm::reflect(it->velocity, normal);
-                float distAfterIntersection = glm::length(nextPos - intersection);
+        if (simulationMode == SimulationMode::Fluid) {
+            fluid.step(state.particles.values(), obstacles, dt);
+            return;
+        }
 
-                it->position = intersection + reflectedVelocity * (distAfterIntersection / glm::length(reflectedVelocity));
-                it->velocity = reflectedVelocity;
-            }
+        if (simulationMode == SimulationMode::Cloth) {
+            constraints.step(state.particles.values(), obstacles, dt);
+            return;
+        }
 
-            if (it->isDead()) {
-                it = particles.erase(it);
-            } else {
-                utils::draw_disk(it->position, it->radius(), it->color());
-                ++it;
+        for (Particle& particle : state.particles)
+        {
+            particle.update(dt);
+
+            if (collisionBackend == CollisionBackend::Analytic)
+                collision::move_particle(particle.position, particle.velocity, dt, obstacles, broadphase, maxBouncesPerStep);
+        }
+        // Après update(), comme pour les collisions analytiques
+        if (collisionBackend == CollisionBackend::DistanceField)
+            collision::move_particles(state.particles.values(), dt, distanceField, maxBouncesPerStep);
+        // En O(1) par particule supprimée : la dernière particule prend la place libérée
+        state.particles.erase_if([](const Particle& particle) { return particle.isDead(); });
+    };
+
+    // Avec PARTICLES_COUNT_ALLOCATIONS : simule quelques images sans rien dessiner, sur une copie de l'état, et vérifie qu'une fois
+    // les premières images passées, la simulation et la mémoire de l'image (gl::frame_arena()) n'allouent plus rien sur le tas.
+    // Avant de créer tout ce qui travaille en arrière-plan (chargement des images, compilation des shaders, capture...) :
+    // les allocations sont comptées sur tous les threads.
+    if constexpr (allocations::isCounting) {
+        if (!recorder && !player) {
+            constexpr int warmupFrames = 10;
+            constexpr int checkedFrames = 120;
+            SimulationState copy = state;
+            size_t allocationsBefore = 0;
+            for (int frame = 0; frame < warmupFrames + checkedFrames; ++frame) {
+                if (frame == warmupFrames)
+                    allocationsBefore = allocations::count();
+                simulate(copy, 1.f / 60.f);
+                gl::frame_arena().reset(); // Comme au début de chaque image de la boucle principale
             }
+            const size_t simulationAllocations = allocations::count() - allocationsBefore;
+            if (simulationAllocations != 0)
+                throw std::runtime_error{std::format("[allocations] La simulation a fait {} allocations sur le tas en {} images", simulationAllocations, checkedFrames)};
         }
+    }
+
+    // Capture d'images : la copie vers le CPU et l'encodage se font en arrière-plan
+    std::optional<gl::PixelReadback> capture;
+    std::optional<gl::ImageWriter> captureWriter;
+    int capturedFrames = 0;
+    if (captureFolder != nullptr) {
+        std::filesystem::create_directories(captureFolder);
+        capture.emplace();
+        captureWriter.emplace();
+    }
+    std::optional<gl::VideoWriter> video;
+    if (videoFile != nullptr)
+        video.emplace(gl::VideoWriter_Descriptor{.path = videoFile, .format = videoFormat});
+    auto saveCapture = [&](gl::ReadPixels pixels) {
+        captureWriter->save(std::format("{}/frame_{:05}.png", captureFolder, capturedFrames++), std::move(pixels));
+    };
+
+    // Les shaders sont dans res/shaders, et sont recompilés dès qu'ils sont modifiés (ceux copiés à côté de l'exécutable)
+    gl::ShaderWatcher shaderWatcher;
+    // Toutes les particules sont dessinées en un seul appel
+    ParticleRenderer particleRenderer{shaderWatcher};
+    // Les images sont décodées en arrière-plan : les particules sont dessinées comme des disques tant que l'atlas n'est pas prêt
+    gl::TextureLoader textureLoader;
+    std::optional<gl::AsyncTextureAtlas> spriteAtlas;
+    if (!spriteFiles.empty())
+        spriteAtlas.emplace(textureLoader.load_atlas(gl::TextureAtlas_Descriptor{
+            .sprites = spriteFiles,
+            .padding = 16, // Chaque niveau de mipmap divise la marge par deux : les images ne débordent pas les unes sur les autres jusqu'au niveau 3 (1/8)
+            .options = {.minification_filter = gl::Filter::LinearMipmapLinear}, // Les particules sont bien plus petites que les images
+        }));
+    // La simulation enregistre ce qu'il faut dessiner (depuis n'importe quel thread), et tout est envoyé à OpenGL d'un coup, trié par état
+    render::CommandBuffer renderCommands;
+    std::optional<PostProcessing> postProcessing;
+    if (postProcessingEnabled)
+        postProcessing.emplace(shaderWatcher, PostProcessing_Settings{.trailsPersistence = trailsPersistence});
+
+    // L'atlas utilisé par draw() : textureLoader.update() le remplace sur le thread principal, donc le thread de simulation
+    // ne doit pas lire spriteAtlas. Il n'est mis à jour qu'entre deux images, quand la simulation est arrêtée.
+    const gl::TextureAtlas* drawnAtlas = nullptr;
+
+    // Peut aussi tourner sur le thread de simulation : n'enregistre que des commandes, qui seront envoyées à OpenGL par le thread principal
+    auto draw = [&](const SimulationState& state) {
+        // Afficher les particules
+        if (usePackedStorage)
+            renderCommands.push(render::PackedParticlesBatch{state.packedParticles, particlesTile});
+        else
+            renderCommands.push(render::ParticlesBatch{
+                .particles = state.particles.values(),
+                .atlas     = drawnAtlas,
+            });
 
         // // Dessiner les lignes
-        // for (const auto& line : lines) {
-        //     utils::draw_line(line.p1, line.p2, 0.005f, glm::vec4(1, 0, 0, 1));
+        // for (const auto& line : obstacles.lines) {
+        //     renderCommands.push(render::Line{line.p1, line.p2, 0.005f, glm::vec4(1, 0, 0, 1)});
         // }
 
         // // Dessiner les cercles
-        // for (const auto& circle : circles) {
-        //     utils::draw_disk(circle.center, circle.radius, glm::vec4(1, 0, 0, 0.5f));
+        // for (const auto& circle : obstacles.circles) {
+        //     renderCommands.push(render::Disk{circle.center, circle.radius, glm::vec4(1, 0, 0, 0.5f)}, render::Blend::Alpha);
         // }
+    };
+
+    // Avec pipelinedSimulation, les commandes de l'image suivante sont enregistrées sur le thread de simulation pendant que celles
+    // de l'image courante sont dessinées. Les données pointées par les commandes restent intactes jusqu'à la barrière suivante.
+    auto simulateAndDraw = [&](SimulationState& state, float dt) {
+        simulate(state, dt);
+        draw(state);
+    };
+
+    // L'état dessiné reste intact pendant que le thread de simulation calcule le suivant dans une deuxième copie
+    std::optional<Pipeline<SimulationState>> pipeline;
+    if (pipelinedSimulation && !player)
+        pipeline.emplace(std::move(state), simulateAndDraw);
+
+    size_t frameIndex = 0;
+    size_t allocationsBeforeFrame = allocations::count();
+    while (gl::window_is_open())
+    {
+        const float dt = gl::delta_time_in_seconds();
+        textureLoader.update();
+        shaderWatcher.update();
+        if (player && player->frames_count() != 0) {
+            const replay::Frame& frame = player->seek(replayFrame);
+            replayFrame = (replayFrame + 1) % player->frames_count();
+            renderCommands.push(render::DisksBatch{frame.positions, frame.radii, frame.colors});
+            renderCommands.swap();
+        } else if (pipeline) {
+            // Dessine ce que le thread de simulation a enregistré pendant l'image précédente
+            pipeline->next_frame(dt, [&]() {
+                renderCommands.swap();
+                drawnAtlas = spriteAtlas ? spriteAtlas->atlas() : nullptr;
+            });
+        } else {
+            drawnAtlas = spriteAtlas ? spriteAtlas->atlas() : nullptr;
+            simulateAndDraw(state, dt);
+            renderCommands.swap();
+        }
+
+        if (postProcessing) {
+            postProcessing->render([&]() { renderCommands.submit(particleRenderer); });
+        } else {
+            glClearColor(0.f, 0.f, 0.f, 1.f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            renderCommands.submit(particleRenderer);
+        }
+
+        if (capture) {
+            // Les pixels arrivent une ou deux images plus tard, sans bloquer le GPU
+            auto pixels = capture->try_get();
+            auto oldest = capture->request(0, GL_BACK, gl::framebuffer_width_in_pixels(), gl::framebuffer_height_in_pixels());
+            if (pixels)
+                saveCapture(std::move(*pixels));
+            if (oldest)
+                saveCapture(std::move(*oldest));
+        }
+        if (video)
+            video->capture(0, GL_BACK, gl::framebuffer_width_in_pixels(), gl::framebuffer_height_in_pixels());
+
+        if (printFrameTimes && frameIndex % 300 == 299) {
+            const gl::FrameTimes times = gl::frame_times();
+            std::cerr << std::format("[images] {:.1f} ips, médiane {:.2f} ms, 95 % {:.2f} ms, 99 % {:.2f} ms, max {:.2f} ms\n",
+                                     1. / times.smoothed, times.median * 1000., times.percentile_95 * 1000., times.percentile_99 * 1000., times.max * 1000.);
+        }
+
+        if constexpr (allocations::isCounting) {
+            // Une fois les premières images passées (tampons, textures, cache des uniforms...), une image ne devrait plus rien allouer sur le tas
+            size_t const frameAllocations = allocations::count() - allocationsBeforeFrame;
+            if (frameAllocations != 0 && frameIndex > 10)
+                std::cerr << std::format("[allocations] image {} : {} allocations sur le tas\n", frameIndex, frameAllocations);
+            allocationsBeforeFrame = allocations::count();
+        }
+        frameIndex++;
+    }
+
+    if (capture) {
+        while (auto pixels = capture->get())
+            saveCapture(std::move(*pixels));
+    }
+
+    if (pipeline)
+        state = pipeline->finish();
+    if (snapshotFile != nullptr && simulationMode != SimulationMode::Cloth) {
+        if (usePackedStorage) {
+            packed::unpack(state.packedParticles, particlesTile, particles);
+            snapshot::save(snapshotPath, particles, obstacles, snapshotCompression);
+        } else {
+            snapshot::save(snapshotPath, state.particles.values(), obstacles, snapshotCompression);
+        }
     }
 }
\ No newline at end of file
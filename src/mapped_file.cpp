@@ -0,0 +1,103 @@
+#include "mapped_file.hpp"
+#include <stdexcept>
+#include <utility>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(std::filesystem::path const& path)
+{
+    auto const fail = [&]() {
+        unmap();
+        throw std::runtime_error{"[MappedFile] Failed to map \"" + path.string() + "\""};
+    };
+
+#if defined(_WIN32)
+    _file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE) {
+        _file = nullptr;
+        fail();
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(_file, &size))
+        fail();
+    _size = static_cast<size_t>(size.QuadPart);
+    if (_size == 0)
+        return;
+    _mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!_mapping)
+        fail();
+    _data = MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!_data)
+        fail();
+#else
+    int const file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        fail();
+    struct stat info{};
+    if (fstat(file, &info) != 0) {
+        close(file);
+        fail();
+    }
+    _size = static_cast<size_t>(info.st_size);
+    if (_size != 0) {
+        _data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (_data == MAP_FAILED) {
+            _data = nullptr;
+            close(file);
+            fail();
+        }
+    }
+    close(file); // The mapping stays valid after the file is closed
+#endif
+}
+
+void MappedFile::unmap()
+{
+#if defined(_WIN32)
+    if (_data)
+        UnmapViewOfFile(_data);
+    if (_mapping)
+        CloseHandle(_mapping);
+    if (_file)
+        CloseHandle(_file);
+    _mapping = nullptr;
+    _file    = nullptr;
+#else
+    if (_data)
+        munmap(_data, _size);
+#endif
+    _data = nullptr;
+    _size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& o) noexcept
+{
+    *this = std::move(o);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& o) noexcept
+{
+    if (this != &o) {
+        unmap();
+        std::swap(_data, o._data);
+        std::swap(_size, o._size);
+#if defined(_WIN32)
+        std::swap(_file, o._file);
+        std::swap(_mapping, o._mapping);
+#endif
+    }
+    return *this;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+// Read-only view of a whole file, mapped in memory by the OS (pages are only loaded when they are accessed)
+class MappedFile {
+public:
+    MappedFile() = default;
+    // Throws a std::runtime_error if the file can't be opened
+    explicit MappedFile(std::filesystem::path const& path);
+    ~MappedFile();
+    MappedFile(MappedFile const&)            = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+    MappedFile(MappedFile&&) noexcept;
+    MappedFile& operator=(MappedFile&&) noexcept;
+
+    std::span<std::byte const> bytes() const { return {static_cast<std::byte const*>(_data), _size}; }
+    size_t size() const { return _size; }
+
+private:
+    void unmap();
+
+private:
+    void*  _data{nullptr};
+    size_t _size{0};
+#if defined(_WIN32)
+    void* _file{nullptr};
+    void* _mapping{nullptr};
+#endif
+};
@@ -0,0 +1,302 @@
+#include "packed_particles.hpp"
+#include <bit>
+#include <glm/gtc/packing.hpp>
+#include "parallel.hpp"
+
+namespace packed {
+
+// Stochastic rounding needs a random number per value. They are hashes of the particle itself and of the seed given to pack(),
+// so that pack() stays deterministic and doesn't need any state shared between the threads.
+// Finalizer of MurmurHash3. It needs the multiplications: a hash made of shifts and xors only is linear,
+// and the rounding then correlates with the values, which biases it.
+static uint32_t mix(uint32_t h)
+{
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+static uint32_t seed(glm::vec2 const& position, float age, uint32_t frameSeed)
+{
+    return std::bit_cast<uint32_t>(position.x) ^ std::rotl(std::bit_cast<uint32_t>(position.y), 16) ^ std::bit_cast<uint32_t>(age) ^ frameSeed;
+}
+
+// In [0, 1)
+static float dither(uint32_t h)
+{
+    return static_cast<float>(h >> 8) * (1.f / 16777216.f);
+}
+
+// value is in steps of the 16 bits fixed point. Rounds up with a probability equal to its fractional part when dither is uniform in [0, 1).
+static uint16_t quantize(float value, float dither)
+{
+    return static_cast<uint16_t>(glm::clamp(value + dither, 0.f, 65535.f));
+}
+
+// What is actually stored, the age is packed relative to it so that it unpacks to the same value
+static float stored_lifetime(float lifetime)
+{
+    return glm::unpackHalf1x16(glm::packHalf1x16(lifetime));
+}
+
+static void pack_1(::Particle const& particle, Tile const& tile, uint32_t frameSeed, Particle& packed)
+{
+    float const     lifetime = stored_lifetime(particle.lifetime);
+    uint32_t const  hx       = mix(seed(particle.position, particle.age, frameSeed));
+    uint32_t const  hy       = mix(hx);
+    uint32_t const  hAge     = mix(hy);
+    glm::vec2 const fixed    = (particle.position - tile.origin) * (65535.f / tile.size);
+    packed = Particle{
+        .position    = {quantize(fixed.x, dither(hx)), quantize(fixed.y, dither(hy))},
+        .velocity    = particle.velocity,
+        .mass        = glm::packHalf1x16(particle.mass),
+        .startRadius = glm::packHalf1x16(particle.startRadius),
+        .lifetime    = glm::packHalf1x16(lifetime),
+        .age         = quantize(glm::clamp(particle.age / lifetime, 0.f, 1.f) * 65535.f, dither(hAge)),
+        .startColor  = pack_rgba8(particle.startColor),
+        .endColor    = pack_rgba8(particle.endColor),
+    };
+}
+
+static void unpack_1(Particle const& source, Tile const& tile, ::Particle& particle)
+{
+    particle.position    = unpack_position(source.position, tile);
+    particle.velocity    = source.velocity;
+    particle.mass        = glm::unpackHalf1x16(source.mass);
+    particle.startRadius = glm::unpackHalf1x16(source.startRadius);
+    particle.lifetime    = glm::unpackHalf1x16(source.lifetime);
+    particle.age         = unpack_unorm16(source.age) * particle.lifetime;
+    particle.startColor  = unpack_rgba8(source.startColor);
+    particle.endColor    = unpack_rgba8(source.endColor);
+}
+
+#if defined(PARTICLES_PACKING_SSE2)
+
+// Same as the scalar versions above, on 4 particles at a time: each register holds the same member of 4 particles.
+// pack_4() and pack_1() give exactly the same results, so it doesn't matter which particles end up in the tail of a chunk.
+
+// SSE2 can only multiply 2 of the 4 lanes at a time (_mm_mullo_epi32() is SSE4.1)
+static __m128i multiply(__m128i a, uint32_t b)
+{
+    __m128i const factor = _mm_set1_epi32(static_cast<int>(b));
+    __m128i const even   = _mm_mul_epu32(a, factor);
+    __m128i const odd    = _mm_mul_epu32(_mm_srli_epi64(a, 32), factor);
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static __m128i mix(__m128i h)
+{
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+    h = multiply(h, 0x85EBCA6Bu);
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 13));
+    h = multiply(h, 0xC2B2AE35u);
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+    return h;
+}
+
+static __m128 dither(__m128i h)
+{
+    return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(h, 8)), _mm_set1_ps(1.f / 16777216.f));
+}
+
+// Returns the 8 words a0 a1 a2 a3 b0 b1 b2 b3.
+// There is no unsigned saturation from 32 to 16 bits in SSE2, so we clamp first, and go through signed values centered on 0.
+static __m128i quantize(__m128 a, __m128 b)
+{
+    auto const to_int = [](__m128 value) {
+        value = _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(65535.f)); // _mm_max_ps() gives 0 for NaN
+        return _mm_sub_epi32(_mm_cvttps_epi32(value), _mm_set1_epi32(32768));
+    };
+    return _mm_xor_si128(_mm_packs_epi32(to_int(a), to_int(b)), _mm_set1_epi16(static_cast<short>(0x8000)));
+}
+
+// 4 colors in 16 bytes
+static __m128i pack_rgba8_4(glm::vec4 const& c0, glm::vec4 const& c1, glm::vec4 const& c2, glm::vec4 const& c3)
+{
+    __m128 const  scale = _mm_set1_ps(255.f);
+    __m128i const v0    = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(&c0.x), scale)); // Rounds to nearest
+    __m128i const v1    = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(&c1.x), scale));
+    __m128i const v2    = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(&c2.x), scale));
+    __m128i const v3    = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(&c3.x), scale));
+    return _mm_packus_epi16(_mm_packs_epi32(v0, v1), _mm_packs_epi32(v2, v3)); // Saturates to [0, 255]
+}
+
+static void unpack_rgba8_4(__m128i bytes, glm::vec4& c0, glm::vec4& c1, glm::vec4& c2, glm::vec4& c3)
+{
+    __m128 const  scale = _mm_set1_ps(1.f / 255.f);
+    __m128i const zero  = _mm_setzero_si128();
+    __m128i const low   = _mm_unpacklo_epi8(bytes, zero);
+    __m128i const high  = _mm_unpackhi_epi8(bytes, zero);
+    _mm_storeu_ps(&c0.x, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale));
+    _mm_storeu_ps(&c1.x, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale));
+    _mm_storeu_ps(&c2.x, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale));
+    _mm_storeu_ps(&c3.x, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale));
+}
+
+static int as_int(std::array<uint8_t, 4> const& bytes)
+{
+    int result;
+    std::memcpy(&result, bytes.data(), sizeof(result));
+    return result;
+}
+
+static int as_int(std::array<uint16_t, 2> const& words)
+{
+    int result;
+    std::memcpy(&result, words.data(), sizeof(result));
+    return result;
+}
+
+static void pack_4(::Particle const* particles, Tile const& tile, uint32_t frameSeed, Particle* packed)
+{
+    float const lifetimes[4] = {
+        stored_lifetime(particles[0].lifetime),
+        stored_lifetime(particles[1].lifetime),
+        stored_lifetime(particles[2].lifetime),
+        stored_lifetime(particles[3].lifetime),
+    };
+    __m128 const x   = _mm_setr_ps(particles[0].position.x, particles[1].position.x, particles[2].position.x, particles[3].position.x);
+    __m128 const y   = _mm_setr_ps(particles[0].position.y, particles[1].position.y, particles[2].position.y, particles[3].position.y);
+    __m128 const age = _mm_setr_ps(particles[0].age, particles[1].age, particles[2].age, particles[3].age);
+
+    __m128i const seed = _mm_xor_si128(
+        _mm_xor_si128(_mm_castps_si128(x), _mm_castps_si128(age)),
+        _mm_xor_si128(
+            _mm_or_si128(_mm_slli_epi32(_mm_castps_si128(y), 16), _mm_srli_epi32(_mm_castps_si128(y), 16)), // Rotation by 16 bits
+            _mm_set1_epi32(static_cast<int>(frameSeed))
+        )
+    );
+    __m128i const hx   = mix(seed);
+    __m128i const hy   = mix(hx);
+    __m128i const hAge = mix(hy);
+
+    __m128 const scale     = _mm_set1_ps(65535.f / tile.size);
+    __m128 const fixedX    = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(x, _mm_set1_ps(tile.origin.x)), scale), dither(hx));
+    __m128 const fixedY    = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(y, _mm_set1_ps(tile.origin.y)), scale), dither(hy));
+    __m128 const fraction  = _mm_min_ps(_mm_max_ps(_mm_div_ps(age, _mm_loadu_ps(lifetimes)), _mm_setzero_ps()), _mm_set1_ps(1.f));
+    __m128 const fixedAge  = _mm_add_ps(_mm_mul_ps(fraction, _mm_set1_ps(65535.f)), dither(hAge));
+    __m128i const xy       = quantize(fixedX, fixedY);                         // x0 x1 x2 x3 y0 y1 y2 y3
+    __m128i const positions = _mm_unpacklo_epi16(xy, _mm_unpackhi_epi64(xy, xy)); // x0 y0 x1 y1 x2 y2 x3 y3
+
+    alignas(16) std::array<std::array<uint16_t, 2>, 4> packedPositions;
+    alignas(16) std::array<uint16_t, 8>                packedAges;
+    alignas(16) std::array<std::array<uint8_t, 4>, 4>  startColors;
+    alignas(16) std::array<std::array<uint8_t, 4>, 4>  endColors;
+    _mm_store_si128(reinterpret_cast<__m128i*>(packedPositions.data()), positions); // NOLINT(*reinterpret-cast)
+    _mm_store_si128(reinterpret_cast<__m128i*>(packedAges.data()), quantize(fixedAge, fixedAge)); // NOLINT(*reinterpret-cast)
+    _mm_store_si128(reinterpret_cast<__m128i*>(startColors.data()), pack_rgba8_4(particles[0].startColor, particles[1].startColor, particles[2].startColor, particles[3].startColor)); // NOLINT(*reinterpret-cast)
+    _mm_store_si128(reinterpret_cast<__m128i*>(endColors.data()), pack_rgba8_4(particles[0].endColor, particles[1].endColor, particles[2].endColor, particles[3].endColor)); // NOLINT(*reinterpret-cast)
+
+    for (size_t k = 0; k < 4; ++k)
+    {
+        packed[k] = Particle{
+            .position    = packedPositions[k],
+            .velocity    = particles[k].velocity,
+            .mass        = glm::packHalf1x16(particles[k].mass),
+            .startRadius = glm::packHalf1x16(particles[k].startRadius),
+            .lifetime    = glm::packHalf1x16(lifetimes[k]),
+            .age         = packedAges[k],
+            .startColor  = startColors[k],
+            .endColor    = endColors[k],
+        };
+    }
+}
+
+static void unpack_4(Particle const* packed, Tile const& tile, ::Particle* particles)
+{
+    // The positions of 2 particles per register
+    __m128i const words  = _mm_setr_epi32(as_int(packed[0].position), as_int(packed[1].position), as_int(packed[2].position), as_int(packed[3].position));
+    __m128 const  step   = _mm_set1_ps(tile.step());
+    __m128 const  origin = _mm_setr_ps(tile.origin.x, tile.origin.y, tile.origin.x, tile.origin.y);
+    alignas(16) std::array<glm::vec2, 4> positions;
+    _mm_store_ps(&positions[0].x, _mm_add_ps(origin, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words, _mm_setzero_si128())), step)));
+    _mm_store_ps(&positions[2].x, _mm_add_ps(origin, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(words, _mm_setzero_si128())), step)));
+
+    alignas(16) std::array<float, 4> lifetimes;
+    for (size_t k = 0; k < 4; ++k)
+        lifetimes[k] = glm::unpackHalf1x16(packed[k].lifetime);
+    __m128i const ageWords = _mm_setr_epi32(packed[0].age, packed[1].age, packed[2].age, packed[3].age);
+    alignas(16) std::array<float, 4> ages;
+    _mm_store_ps(ages.data(), _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(ageWords), _mm_set1_ps(1.f / 65535.f)), _mm_load_ps(lifetimes.data())));
+
+    for (size_t k = 0; k < 4; ++k)
+    {
+        ::Particle& particle = particles[k];
+        particle.position    = positions[k];
+        particle.velocity    = packed[k].velocity;
+        particle.mass        = glm::unpackHalf1x16(packed[k].mass);
+        particle.startRadius = glm::unpackHalf1x16(packed[k].startRadius);
+        particle.lifetime    = lifetimes[k];
+        particle.age         = ages[k];
+    }
+    unpack_rgba8_4(_mm_setr_epi32(as_int(packed[0].startColor), as_int(packed[1].startColor), as_int(packed[2].startColor), as_int(packed[3].startColor)),
+                   particles[0].startColor, particles[1].startColor, particles[2].startColor, particles[3].startColor);
+    unpack_rgba8_4(_mm_setr_epi32(as_int(packed[0].endColor), as_int(packed[1].endColor), as_int(packed[2].endColor), as_int(packed[3].endColor)),
+                   particles[0].endColor, particles[1].endColor, particles[2].endColor, particles[3].endColor);
+}
+
+#endif
+
+void pack(std::span<::Particle const> particles, Tile const& tile, std::span<Particle> packed, uint32_t seed)
+{
+    uint32_t const frameSeed = mix(seed); // Consecutive seeds must not only flip the lowest bits
+    parallel::for_each_chunk(particles.size(), [&](size_t begin, size_t end) {
+        size_t i = begin;
+#if defined(PARTICLES_PACKING_SSE2)
+        for (; i + 4 <= end; i += 4)
+            pack_4(&particles[i], tile, frameSeed, &packed[i]);
+#endif
+        for (; i < end; ++i)
+            pack_1(particles[i], tile, frameSeed, packed[i]);
+    });
+}
+
+auto pack(std::span<::Particle const> particles, Tile const& tile, uint32_t seed) -> std::vector<Particle>
+{
+    std::vector<Particle> packed(particles.size());
+    pack(particles, tile, packed, seed);
+    return packed;
+}
+
+void unpack(std::span<Particle const> packed, Tile const& tile, std::span<::Particle> particles)
+{
+    parallel::for_each_chunk(packed.size(), [&](size_t begin, size_t end) {
+        size_t i = begin;
+#if defined(PARTICLES_PACKING_SSE2)
+        for (; i + 4 <= end; i += 4)
+            unpack_4(&packed[i], tile, &particles[i]);
+#endif
+        for (; i < end; ++i)
+            unpack_1(packed[i], tile, particles[i]);
+    });
+}
+
+void unpack(std::span<Particle const> packed, Tile const& tile, std::vector<::Particle>& particles)
+{
+    // Every constructor of Particle draws random values, which is slow and takes the lock of std::rand(): only build one, once.
+    // Its values don't matter, they are all overwritten.
+    static ::Particle const filler{glm::vec2{0.f}};
+    particles.resize(packed.size(), filler);
+    unpack(packed, tile, std::span<::Particle>{particles});
+}
+
+glm::vec2 position(Particle const& particle, Tile const& tile)
+{
+    return unpack_position(particle.position, tile);
+}
+
+float radius(Particle const& particle)
+{
+    float const lifetime = glm::unpackHalf1x16(particle.lifetime);
+    return ::Particle::radius_at(glm::unpackHalf1x16(particle.startRadius), lifetime, unpack_unorm16(particle.age) * lifetime);
+}
+
+glm::vec4 color(Particle const& particle)
+{
+    return ::Particle::color_at(unpack_rgba8(particle.startColor), unpack_rgba8(particle.endColor), unpack_unorm16(particle.age));
+}
+
+} // namespace packed
@@ -0,0 +1,109 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Struct/Particles.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PARTICLES_PACKING_SSE2
+#endif
+
+// Compressed storage of the particles, for when memory and bandwidth matter more than the last bits of precision:
+// colors are stored as RGBA8 (they are only ever displayed as 8 bits anyway), the age as a fraction of the lifetime in 16 bits,
+// and positions as 16 bits fixed point relative to the origin of a tile.
+// The particles are unpacked, updated and packed again each frame, so the age and the positions use stochastic rounding:
+// they round up with a probability equal to their fractional part, and what a frame adds is kept on average, however small.
+namespace packed {
+
+// Square area covered by the fixed point positions. Positions outside of it are clamped to its border.
+struct Tile {
+    glm::vec2 origin{-1.f};
+    float     size{2.f};
+
+    // Smallest tile containing the [min, max] box
+    static Tile covering(glm::vec2 min, glm::vec2 max) { return Tile{min, glm::max(max.x - min.x, max.y - min.y)}; }
+
+    // Distance between two representable positions. Thanks to the stochastic rounding, slower motions are kept on average,
+    // but the particle then jumps by one step at random frames instead of moving smoothly: below step() / dt, e.g. 0.0035 units per second
+    // for a tile of size 3.8 (a 16:9 window plus margins) at 60 images per second, a particle visibly moves by jolts.
+    float step() const { return size / 65535.f; }
+};
+
+// 28 bytes instead of the 64 of a Particle
+struct Particle {
+    std::array<uint16_t, 2> position;    // Fixed point, relative to the origin of the tile
+    glm::vec2               velocity;    // Kept as floats, the collisions are too sensitive to it
+    uint16_t                mass;        // Half float
+    uint16_t                startRadius; // Half float
+    uint16_t                lifetime;    // Half float
+    uint16_t                age;         // Fraction of the lifetime, as 16 bits fixed point in [0, 1]
+    std::array<uint8_t, 4>  startColor;  // RGBA8
+    std::array<uint8_t, 4>  endColor;    // RGBA8
+};
+static_assert(sizeof(Particle) == 28);
+
+// seed changes the random numbers of the stochastic rounding, and must change every frame (e.g. the index of the frame):
+// otherwise a particle that moves by less than a step per frame is unpacked to the same value each frame, rounds the same way, and never moves.
+void pack(std::span<::Particle const> particles, Tile const& tile, std::span<Particle> packed, uint32_t seed);
+auto pack(std::span<::Particle const> particles, Tile const& tile, uint32_t seed = 0) -> std::vector<Particle>;
+// Overwrites all the members of the particles, which must have the same size as packed
+void unpack(std::span<Particle const> packed, Tile const& tile, std::span<::Particle> particles);
+void unpack(std::span<Particle const> packed, Tile const& tile, std::vector<::Particle>& particles);
+
+glm::vec2 position(Particle const& particle, Tile const& tile);
+float     radius(Particle const& particle);
+glm::vec4 color(Particle const& particle);
+
+// Kernels for one value, useful to fill GPU buffers. They use SSE2 when it is available.
+// pack() and unpack() have their own versions, that convert 4 particles at a time.
+
+inline std::array<uint8_t, 4> pack_rgba8(glm::vec4 const& color)
+{
+    std::array<uint8_t, 4> result;
+#if defined(PARTICLES_PACKING_SSE2)
+    __m128i const value = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(&color.x), _mm_set1_ps(255.f))); // Rounds to nearest
+    __m128i const bytes = _mm_packus_epi16(_mm_packs_epi32(value, value), _mm_setzero_si128());   // Saturates to [0, 255]
+    int const packed    = _mm_cvtsi128_si32(bytes);
+    std::memcpy(result.data(), &packed, sizeof(result));
+#else
+    for (glm::length_t i = 0; i < 4; ++i)
+        result[static_cast<size_t>(i)] = static_cast<uint8_t>(glm::clamp(color[i], 0.f, 1.f) * 255.f + 0.5f);
+#endif
+    return result;
+}
+
+inline glm::vec4 unpack_rgba8(std::array<uint8_t, 4> const& color)
+{
+#if defined(PARTICLES_PACKING_SSE2)
+    int packed;
+    std::memcpy(&packed, color.data(), sizeof(packed));
+    __m128i const bytes = _mm_cvtsi32_si128(packed);
+    __m128i const value = _mm_unpacklo_epi16(_mm_unpacklo_epi8(bytes, _mm_setzero_si128()), _mm_setzero_si128());
+    glm::vec4 result;
+    _mm_storeu_ps(&result.x, _mm_mul_ps(_mm_cvtepi32_ps(value), _mm_set1_ps(1.f / 255.f)));
+    return result;
+#else
+    return glm::vec4{color[0], color[1], color[2], color[3]} / 255.f;
+#endif
+}
+
+inline uint16_t pack_unorm16(float value)
+{
+    return static_cast<uint16_t>(glm::clamp(value, 0.f, 1.f) * 65535.f + 0.5f);
+}
+
+inline float unpack_unorm16(uint16_t value)
+{
+    return static_cast<float>(value) / 65535.f;
+}
+
+inline glm::vec2 unpack_position(std::array<uint16_t, 2> const& position, Tile const& tile)
+{
+    return tile.origin + glm::vec2{position[0], position[1]} * tile.step();
+}
+
+} // namespace packed
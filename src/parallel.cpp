@@ -0,0 +1,168 @@
+#include "parallel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "opengl-framework/opengl-framework.hpp"
+
+namespace parallel {
+
+namespace {
+
+thread_local size_t current_thread_index = 0;
+thread_local bool   is_inside_job        = false;
+
+struct Job {
+    std::function<void(size_t, size_t)> const* function{nullptr};
+    size_t count{0};
+    size_t chunk_size{1};
+    size_t chunks_count{0};
+};
+
+class ThreadPool {
+public:
+    ThreadPool()
+    {
+        size_t const workers_count = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+        for (size_t i = 0; i < workers_count; ++i)
+            _workers.emplace_back([this, i]() { worker_loop(i + 1); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::scoped_lock lock{_mutex};
+            _stop = true;
+        }
+        _wake_up.notify_all();
+        for (auto& worker : _workers)
+            worker.join();
+    }
+
+    ThreadPool(ThreadPool const&)            = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    size_t thread_count() const { return _workers.size() + 1; }
+
+    void run(size_t count, std::function<void(size_t, size_t)> const& function, size_t min_chunk_size)
+    {
+        std::scoped_lock submit_lock{_submit_mutex}; // Only one loop at a time can use the workers
+
+        Job job{};
+        job.function     = &function;
+        job.count        = count;
+        job.chunk_size   = std::max({min_chunk_size, size_t{1}, (count + thread_count() * 4 - 1) / (thread_count() * 4)});
+        job.chunks_count = (count + job.chunk_size - 1) / job.chunk_size;
+
+        {
+            std::unique_lock lock{_mutex};
+            // Wait for the workers that woke up late for the previous job, so that they don't steal chunks from this one
+            _done.wait(lock, [&]() { return _busy_workers == 0; });
+            _job = job;
+            _pending.store(job.chunks_count);
+            _next_chunk.store(0);
+            ++_generation;
+        }
+        _wake_up.notify_all();
+
+        execute_chunks(job);
+
+        std::unique_lock lock{_mutex};
+        _done.wait(lock, [&]() { return _pending.load() == 0; });
+    }
+
+private:
+    void execute_chunks(Job const& job)
+    {
+        is_inside_job = true;
+        while (true)
+        {
+            size_t const chunk = _next_chunk.fetch_add(1);
+            if (chunk >= job.chunks_count)
+                break;
+            size_t const begin = chunk * job.chunk_size;
+            size_t const end   = std::min(begin + job.chunk_size, job.count);
+            (*job.function)(begin, end);
+            if (_pending.fetch_sub(1) == 1)
+            {
+                std::scoped_lock lock{_mutex};
+                _done.notify_all();
+            }
+        }
+        is_inside_job = false;
+    }
+
+    void worker_loop(size_t index)
+    {
+        current_thread_index = index;
+        uint64_t last_generation = 0;
+        while (true)
+        {
+            Job job{};
+            {
+                std::unique_lock lock{_mutex};
+                _wake_up.wait(lock, [&]() { return _stop || _generation != last_generation; });
+                if (_stop)
+                    return;
+                last_generation = _generation;
+                job             = _job;
+                ++_busy_workers;
+            }
+            execute_chunks(job);
+            gl::frame_arena().reset(); // The scratch memory of the workers only lives for one job
+            {
+                std::scoped_lock lock{_mutex};
+                --_busy_workers;
+            }
+            _done.notify_all();
+        }
+    }
+
+private:
+    std::vector<std::thread> _workers{};
+    std::mutex               _submit_mutex{};
+    std::mutex               _mutex{};
+    std::condition_variable  _wake_up{};
+    std::condition_variable  _done{};
+    Job                      _job{};
+    uint64_t                 _generation{0};
+    size_t                   _busy_workers{0};
+    bool                     _stop{false};
+    std::atomic<size_t>      _next_chunk{0};
+    std::atomic<size_t>      _pending{0};
+};
+
+ThreadPool& pool()
+{
+    static ThreadPool instance{};
+    return instance;
+}
+
+} // namespace
+
+size_t thread_count()
+{
+    return pool().thread_count();
+}
+
+size_t thread_index()
+{
+    return current_thread_index;
+}
+
+void for_each_chunk(size_t count, std::function<void(size_t begin, size_t end)> const& job, size_t min_chunk_size)
+{
+    if (count == 0)
+        return;
+    if (is_inside_job || count <= min_chunk_size || pool().thread_count() == 1)
+    {
+        job(0, count);
+        return;
+    }
+    pool().run(count, job, min_chunk_size);
+}
+
+} // namespace parallel
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+namespace parallel {
+
+/// Number of threads that take part in a parallel loop (the workers plus the calling thread)
+size_t thread_count();
+
+/// Index of the current thread in [0, thread_count()). The thread that calls for_each_chunk() is always 0.
+size_t thread_index();
+
+/// Splits [0, count) into chunks of at least min_chunk_size elements and runs job(begin, end) on each of them, using all the threads of the pool.
+/// Blocks until all the chunks are done. Calls made from inside a job run serially on the current thread.
+void for_each_chunk(size_t count, std::function<void(size_t begin, size_t end)> const& job, size_t min_chunk_size = 256);
+
+template<typename Function>
+void for_each_index(size_t count, Function&& function, size_t min_chunk_size = 256)
+{
+    for_each_chunk(count, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            function(i);
+    }, min_chunk_size);
+}
+
+} // namespace parallel
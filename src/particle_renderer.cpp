@@ -0,0 +1,137 @@
+#include "particle_renderer.hpp"
+#include <cassert>
+#include <glm/gtc/packing.hpp>
+#include "parallel.hpp"
+
+static gl::Mesh make_particle_mesh()
+{
+    // Two triangles making a square
+    static constexpr float corners[] = {
+        -1.f, -1.f, +1.f, -1.f, +1.f, +1.f, //
+        -1.f, -1.f, +1.f, +1.f, -1.f, +1.f, //
+    };
+    return gl::Mesh{gl::Mesh_Descriptor{
+        .vertex_buffers = {
+            gl::VertexBuffer_Descriptor{
+                .layout = {gl::VertexAttribute::Position2D(0)},
+                .data   = std::as_bytes(std::span{corners}),
+            },
+            gl::VertexBuffer_Descriptor{
+                .layout     = {gl::VertexAttribute::Position2D(1), gl::VertexAttribute::HalfVec2(2), gl::VertexAttribute::ColorRGBA8(3), gl::VertexAttribute::UNorm16Vec4(4)},
+                .divisor    = 1,
+                .is_dynamic = true,
+            },
+        },
+    }};
+}
+
+ParticleRenderer::ParticleRenderer(gl::ShaderWatcher& shaderWatcher)
+    : _shader{shaderWatcher.watch(gl::Shader_Descriptor{
+          .vertex   = gl::ShaderSource::File{"res/shaders/particle.vert"},
+          .fragment = gl::ShaderSource::File{"res/shaders/particle.frag"},
+      })}
+    , _mesh{make_particle_mesh()}
+{
+}
+
+void ParticleRenderer::draw(std::span<Particle const> particles)
+{
+    _instances.resize(particles.size());
+    parallel::for_each_index(particles.size(), [&](size_t i) {
+        auto const& particle = particles[i];
+        _instances[i] = Instance{particle.position, glm::packHalf1x16(particle.radius()), glm::packHalf1x16(0.f), packed::pack_rgba8(particle.color()), {0, 0, 0, 0}};
+    });
+    upload_instances();
+
+    gl::Shader const& shader = _shader.shader(); // Changes when the files are reloaded
+    shader.bind();
+    shader.set_uniform("u_inverse_aspect_ratio", 1.f / gl::framebuffer_aspect_ratio());
+    _mesh.draw_instances(static_cast<GLsizei>(_instances.size()));
+}
+
+void ParticleRenderer::draw(std::span<glm::vec2 const> positions, std::span<float const> radii, std::span<glm::vec4 const> colors)
+{
+    assert(radii.size() == positions.size() && colors.size() == positions.size());
+    _instances.resize(positions.size());
+    parallel::for_each_index(positions.size(), [&](size_t i) {
+        _instances[i] = Instance{positions[i], glm::packHalf1x16(radii[i]), glm::packHalf1x16(0.f), packed::pack_rgba8(colors[i]), {0, 0, 0, 0}};
+    });
+    upload_instances();
+
+    gl::Shader const& shader = _shader.shader(); // Changes when the files are reloaded
+    shader.bind();
+    shader.set_uniform("u_inverse_aspect_ratio", 1.f / gl::framebuffer_aspect_ratio());
+    _mesh.draw_instances(static_cast<GLsizei>(_instances.size()));
+}
+
+void ParticleRenderer::draw(std::span<packed::Particle const> particles, packed::Tile const& tile)
+{
+    _instances.resize(particles.size());
+    parallel::for_each_index(particles.size(), [&](size_t i) {
+        auto const& particle = particles[i];
+        _instances[i] = Instance{packed::position(particle, tile), glm::packHalf1x16(packed::radius(particle)), glm::packHalf1x16(0.f), packed::pack_rgba8(packed::color(particle)), {0, 0, 0, 0}};
+    });
+    upload_instances();
+
+    gl::Shader const& shader = _shader.shader(); // Changes when the files are reloaded
+    shader.bind();
+    shader.set_uniform("u_inverse_aspect_ratio", 1.f / gl::framebuffer_aspect_ratio());
+    _mesh.draw_instances(static_cast<GLsizei>(_instances.size()));
+}
+
+void ParticleRenderer::draw(std::span<Particle const> particles, gl::TextureAtlas const& atlas, std::span<uint32_t const> sprites)
+{
+    auto const regions = atlas.regions();
+    if (regions.empty()) {
+        draw(particles);
+        return;
+    }
+
+    _instances.resize(particles.size());
+    parallel::for_each_index(particles.size(), [&](size_t i) {
+        auto const& particle = particles[i];
+        auto const& region   = regions[(sprites.empty() ? i : sprites[i]) % regions.size()];
+        _instances[i] = Instance{
+            particle.position,
+            glm::packHalf1x16(particle.radius()),
+            glm::packHalf1x16(1.f),
+            packed::pack_rgba8(particle.color()),
+            {packed::pack_unorm16(region.uv_min.x), packed::pack_unorm16(region.uv_min.y), packed::pack_unorm16(region.uv_max.x), packed::pack_unorm16(region.uv_max.y)},
+        };
+    });
+
+    // Group the particles by page (counting sort), so that each page is drawn with a single call
+    size_t const pagesCount = atlas.pages_count();
+    if (pagesCount == 1) {
+        upload_instances();
+        _pageStarts.assign({0, _instances.size()});
+    } else {
+        _pageStarts.assign(pagesCount + 1, 0);
+        auto const pageOf = [&](size_t i) { return regions[(sprites.empty() ? i : sprites[i]) % regions.size()].page; };
+        for (size_t i = 0; i < _instances.size(); ++i)
+            _pageStarts[pageOf(i) + 1]++;
+        for (size_t p = 0; p < pagesCount; ++p)
+            _pageStarts[p + 1] += _pageStarts[p];
+        _sortedInstances.resize(_instances.size());
+        std::pmr::vector<size_t> next(_pageStarts.begin(), _pageStarts.end() - 1, &gl::frame_arena());
+        for (size_t i = 0; i < _instances.size(); ++i)
+            _sortedInstances[next[pageOf(i)]++] = _instances[i];
+        std::swap(_instances, _sortedInstances);
+        upload_instances();
+    }
+
+    gl::Shader const& shader = _shader.shader(); // Changes when the files are reloaded
+    shader.bind();
+    shader.set_uniform("u_inverse_aspect_ratio", 1.f / gl::framebuffer_aspect_ratio());
+    for (size_t page = 0; page + 1 < _pageStarts.size(); ++page) {
+        if (_pageStarts[page + 1] == _pageStarts[page])
+            continue;
+        shader.set_uniform("u_atlas", atlas.page(page));
+        _mesh.draw_instances(static_cast<GLsizei>(_pageStarts[page + 1] - _pageStarts[page]), static_cast<GLsizei>(_pageStarts[page]));
+    }
+}
+
+void ParticleRenderer::upload_instances()
+{
+    _mesh.update_vertex_buffer(1, std::as_bytes(std::span{_instances}));
+}
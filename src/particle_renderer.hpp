@@ -0,0 +1,46 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "opengl-framework/opengl-framework.hpp"
+#include "packed_particles.hpp"
+#include "Struct/Particles.hpp"
+
+// Draws all the particles with one instanced draw call (one per atlas page when drawing sprites),
+// instead of one draw call per particle like utils::draw_disk()
+class ParticleRenderer {
+public:
+    // The shaders are in res/shaders, and are reloaded when they change
+    explicit ParticleRenderer(gl::ShaderWatcher& shaderWatcher);
+
+    // Disks, same look as utils::draw_disk()
+    void draw(std::span<Particle const> particles);
+    // Disks given as separate arrays, e.g. the frames of a replay
+    void draw(std::span<glm::vec2 const> positions, std::span<float const> radii, std::span<glm::vec4 const> colors);
+    // Disks, straight from the compressed storage
+    void draw(std::span<packed::Particle const> particles, packed::Tile const& tile);
+    // Sprites tinted by the color of the particle. Particle i uses the sprite sprites[i] of the atlas,
+    // or sprite i % atlas.regions().size() when sprites is empty.
+    void draw(std::span<Particle const> particles, gl::TextureAtlas const& atlas, std::span<uint32_t const> sprites = {});
+
+private:
+    // 24 bytes instead of the 48 it would take with floats only
+    struct Instance {
+        glm::vec2               position;
+        uint16_t                radius;   // Half float
+        uint16_t                textured; // Half float, 0 for disks, 1 for sprites
+        std::array<uint8_t, 4>  color;    // RGBA8
+        std::array<uint16_t, 4> uvRect;   // uvMin then uvMax, as 16 bits fixed point in [0, 1]
+    };
+    static_assert(sizeof(Instance) == 24);
+
+    void upload_instances();
+
+private:
+    gl::WatchedShader     _shader;
+    gl::Mesh              _mesh; // A square, plus the instances
+    std::vector<Instance> _instances;
+    std::vector<Instance> _sortedInstances;
+    std::vector<size_t>   _pageStarts;
+};
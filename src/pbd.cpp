@@ -0,0 +1,260 @@
+#include "pbd.hpp"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include "collision.hpp"
+#include "parallel.hpp"
+
+namespace pbd {
+
+Solver::Solver(Settings const& settings)
+    : _settings{settings}
+{}
+
+void Solver::add(DistanceConstraint const& constraint)
+{
+    _edges.push_back({constraint.a, constraint.b, constraint.restLength, 0.f, 0.f});
+    _colorsAreDirty = true;
+}
+
+void Solver::add(SpringConstraint const& constraint)
+{
+    assert(constraint.stiffness > 0.f);
+    _edges.push_back({constraint.a, constraint.b, constraint.restLength, 1.f / constraint.stiffness, constraint.damping});
+    _colorsAreDirty = true;
+}
+
+void Solver::add(PinConstraint const& constraint)
+{
+    _pins.push_back(constraint);
+}
+
+void Solver::clear()
+{
+    _edges.clear();
+    _pins.clear();
+    _colorsAreDirty = true;
+}
+
+void Solver::build_colors(size_t particlesCount)
+{
+    // Greedy coloring: each edge takes the first color that none of its two particles uses yet
+    std::pmr::vector<uint64_t> usedColors(particlesCount, 0, &gl::frame_arena());
+    std::pmr::vector<int>      edgeColors(_edges.size(), -1, &gl::frame_arena());
+    std::pmr::vector<size_t>   colorSizes(64, 0, &gl::frame_arena());
+    size_t serialCount = 0;
+    for (size_t i = 0; i < _edges.size(); ++i) {
+        Edge const& edge = _edges[i];
+        assert(edge.a < particlesCount && edge.b < particlesCount && "Constraint on a particle that doesn't exist");
+        uint64_t const used = usedColors[edge.a] | usedColors[edge.b];
+        if (used == ~uint64_t{0}) {
+            serialCount++;
+            continue;
+        }
+        int const color = std::countr_zero(~used);
+        edgeColors[i] = color;
+        colorSizes[static_cast<size_t>(color)]++;
+        usedColors[edge.a] |= uint64_t{1} << color;
+        usedColors[edge.b] |= uint64_t{1} << color;
+    }
+
+    while (!colorSizes.empty() && colorSizes.back() == 0)
+        colorSizes.pop_back();
+
+    _colorStarts.assign(colorSizes.size() + 1, 0);
+    for (size_t c = 0; c < colorSizes.size(); ++c)
+        _colorStarts[c + 1] = _colorStarts[c] + colorSizes[c];
+    _serialEdgesStart = _colorStarts.back();
+
+    _coloredEdges.resize(_edges.size());
+    std::pmr::vector<size_t> cursors(_colorStarts.begin(), _colorStarts.end() - 1, &gl::frame_arena());
+    size_t serialCursor = _serialEdgesStart;
+    for (size_t i = 0; i < _edges.size(); ++i) {
+        if (edgeColors[i] < 0)
+            _coloredEdges[serialCursor++] = _edges[i];
+        else
+            _coloredEdges[cursors[static_cast<size_t>(edgeColors[i])]++] = _edges[i];
+    }
+    assert(serialCursor == _serialEdgesStart + serialCount);
+
+    _coloredParticlesCount = particlesCount;
+    _colorsAreDirty = false;
+}
+
+void Solver::solve_edge(Edge const& edge, float& lambda, float dt)
+{
+    float const wa = _inverseMasses[edge.a];
+    float const wb = _inverseMasses[edge.b];
+    float const w = wa + wb;
+    if (w == 0.f)
+        return;
+
+    glm::vec2 const delta = _positions[edge.a] - _positions[edge.b];
+    float const length = glm::length(delta);
+    if (length < 1e-6f)
+        return;
+    glm::vec2 const normal = delta / length;
+
+    float const constraint = length - edge.restLength;
+    float const alphaTilde = edge.compliance / (dt * dt);
+    float const gamma = edge.compliance * edge.damping / dt;
+    float const relativeMotion = glm::dot(normal, (_positions[edge.a] - _previousPositions[edge.a]) - (_positions[edge.b] - _previousPositions[edge.b]));
+
+    float const deltaLambda = (-constraint - alphaTilde * lambda - gamma * relativeMotion) / ((1.f + gamma) * w + alphaTilde);
+    lambda += deltaLambda;
+    _positions[edge.a] += wa * deltaLambda * normal;
+    _positions[edge.b] -= wb * deltaLambda * normal;
+}
+
+void Solver::solve_collisions(Obstacles const& obstacles, size_t particlesCount)
+{
+    parallel::for_each_index(particlesCount, [&](size_t i) {
+        glm::vec2& position = _positions[i];
+        glm::vec2 const previousPos = _previousPositions[i];
+
+        for (const auto& line : obstacles.lines) {
+            glm::vec2 intersection;
+            if (!collision::intersect_segments(previousPos, position, line.p1, line.p2, intersection))
+                continue;
+            glm::vec2 edge = line.p2 - line.p1;
+            glm::vec2 normal = glm::normalize(glm::vec2(-edge.y, edge.x));
+            if (glm::dot(normal, previousPos - line.p1) < 0.f)
+                normal = -normal;
+            position = intersection + normal * 1e-4f;
+            _contactNormals[i] = normal;
+        }
+
+        for (const auto& circle : obstacles.circles) {
+            glm::vec2 const offset = position - circle.center;
+            float const distance = glm::length(offset);
+            if (distance >= circle.radius)
+                continue;
+            glm::vec2 const normal = distance > 1e-6f ? offset / distance : glm::vec2{0.f, 1.f};
+            position = circle.center + normal * circle.radius;
+            _contactNormals[i] = normal;
+        }
+    });
+}
+
+void Solver::substep(std::span<Particle> particles, Obstacles const& obstacles, float dt)
+{
+    size_t const count = particles.size();
+
+    // Predict
+    parallel::for_each_index(count, [&](size_t i) {
+        _previousPositions[i] = particles[i].position;
+        if (_inverseMasses[i] > 0.f)
+            particles[i].velocity += _settings.gravity * dt;
+        _positions[i] = particles[i].position + particles[i].velocity * dt;
+        _contactNormals[i] = glm::vec2{0.f};
+    });
+
+    // Project the constraints
+    for (auto const& pin : _pins)
+        _positions[pin.particle] = pin.position;
+    std::fill(_lambdas.begin(), _lambdas.end(), 0.f);
+    for (int iteration = 0; iteration < _settings.iterations; ++iteration) {
+        for (size_t color = 0; color + 1 < _colorStarts.size(); ++color) {
+            size_t const begin = _colorStarts[color];
+            parallel::for_each_index(_colorStarts[color + 1] - begin, [&](size_t k) {
+                solve_edge(_coloredEdges[begin + k], _lambdas[begin + k], dt);
+            }, 128);
+        }
+        for (size_t k = _serialEdgesStart; k < _coloredEdges.size(); ++k)
+            solve_edge(_coloredEdges[k], _lambdas[k], dt);
+    }
+
+    solve_collisions(obstacles, count);
+
+    // Update the velocities from the corrected positions
+    parallel::for_each_index(count, [&](size_t i) {
+        Particle& particle = particles[i];
+        particle.velocity = (_positions[i] - _previousPositions[i]) / dt;
+        particle.position = _positions[i];
+
+        glm::vec2 const normal = _contactNormals[i];
+        float const normalSpeed = glm::dot(particle.velocity, normal);
+        if (normalSpeed < 0.f)
+            particle.velocity -= (1.f + _settings.restitution) * normalSpeed * normal;
+    });
+}
+
+void Solver::step(std::span<Particle> particles, Obstacles const& obstacles, float dt)
+{
+    if (particles.empty() || dt <= 0.f)
+        return;
+
+    if (_colorsAreDirty || _coloredParticlesCount != particles.size())
+        build_colors(particles.size());
+
+    size_t const count = particles.size();
+    _inverseMasses.resize(count);
+    _positions.resize(count);
+    _previousPositions.resize(count);
+    _contactNormals.resize(count);
+    _lambdas.resize(_coloredEdges.size());
+
+    for (size_t i = 0; i < count; ++i)
+        _inverseMasses[i] = particles[i].mass > 0.f ? 1.f / particles[i].mass : 0.f;
+    for (auto const& pin : _pins) {
+        assert(pin.particle < count && "Pin on a particle that doesn't exist");
+        _inverseMasses[pin.particle] = 0.f;
+        particles[pin.particle].velocity = glm::vec2{0.f};
+    }
+
+    int const substepsCount = std::max(_settings.substeps, 1);
+    float const substepDt = dt / static_cast<float>(substepsCount);
+    for (int i = 0; i < substepsCount; ++i)
+        substep(particles, obstacles, substepDt);
+}
+
+uint32_t add_rope(std::vector<Particle>& particles, Solver& solver, glm::vec2 start, glm::vec2 end, int segmentsCount, bool pinStart)
+{
+    auto const first = static_cast<uint32_t>(particles.size());
+    float const segmentLength = glm::distance(start, end) / static_cast<float>(segmentsCount);
+    for (int i = 0; i <= segmentsCount; ++i) {
+        particles.emplace_back(glm::mix(start, end, static_cast<float>(i) / static_cast<float>(segmentsCount)));
+        particles.back().startRadius = 0.4f * segmentLength;
+    }
+    for (uint32_t i = 0; i < static_cast<uint32_t>(segmentsCount); ++i)
+        solver.add(DistanceConstraint{first + i, first + i + 1, segmentLength});
+    if (pinStart)
+        solver.add(PinConstraint{first, start});
+    return first;
+}
+
+uint32_t add_cloth(std::vector<Particle>& particles, Solver& solver, glm::vec2 topLeft, int columns, int rows, float spacing, float stiffness)
+{
+    auto const first = static_cast<uint32_t>(particles.size());
+    auto const index = [&](int x, int y) { return first + static_cast<uint32_t>(x + y * columns); };
+
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < columns; ++x) {
+            particles.emplace_back(topLeft + glm::vec2{static_cast<float>(x), -static_cast<float>(y)} * spacing);
+            particles.back().startRadius = 0.4f * spacing;
+        }
+    }
+
+    float const diagonal = spacing * std::sqrt(2.f);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < columns; ++x) {
+            // Structural
+            if (x + 1 < columns)
+                solver.add(SpringConstraint{index(x, y), index(x + 1, y), spacing, stiffness});
+            if (y + 1 < rows)
+                solver.add(SpringConstraint{index(x, y), index(x, y + 1), spacing, stiffness});
+            // Shear
+            if (x + 1 < columns && y + 1 < rows) {
+                solver.add(SpringConstraint{index(x, y), index(x + 1, y + 1), diagonal, stiffness});
+                solver.add(SpringConstraint{index(x + 1, y), index(x, y + 1), diagonal, stiffness});
+            }
+        }
+    }
+
+    solver.add(PinConstraint{index(0, 0), topLeft});
+    solver.add(PinConstraint{index(columns - 1, 0), topLeft + glm::vec2{static_cast<float>(columns - 1) * spacing, 0.f}});
+    return first;
+}
+
+} // namespace pbd
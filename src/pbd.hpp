@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Struct/Obstacles.hpp"
+#include "Struct/Particles.hpp"
+
+namespace pbd {
+
+// Keeps two particles at a fixed distance
+struct DistanceConstraint {
+    uint32_t a, b;
+    float    restLength;
+};
+
+// Soft distance constraint: the larger the stiffness, the closer it gets to a DistanceConstraint
+struct SpringConstraint {
+    uint32_t a, b;
+    float    restLength;
+    float    stiffness;
+    float    damping = 0.f;
+};
+
+// Nails a particle to a position in the world
+struct PinConstraint {
+    uint32_t  particle;
+    glm::vec2 position;
+};
+
+struct Settings {
+    int       substeps    = 4;
+    int       iterations  = 4;                 // Solver iterations per substep
+    glm::vec2 gravity     = {0.f, -2.f};
+    float     restitution = 0.2f;              // Fraction of the normal velocity kept when bouncing on an obstacle
+};
+
+// Position-based dynamics (XPBD flavor, so that springs behave the same whatever the number of iterations).
+// The constraints are split into colors, inside which no two constraints share a particle: each color is solved in parallel with no synchronization.
+class Solver {
+public:
+    explicit Solver(Settings const& settings = {});
+
+    Settings&       settings() { return _settings; }
+    Settings const& settings() const { return _settings; }
+
+    void add(DistanceConstraint const&);
+    void add(SpringConstraint const&);
+    void add(PinConstraint const&);
+    void clear();
+
+    size_t constraints_count() const { return _edges.size() + _pins.size(); }
+    size_t colors_count() const { return _colorStarts.empty() ? 0 : _colorStarts.size() - 1; }
+
+    void step(std::span<Particle> particles, Obstacles const& obstacles, float dt);
+
+private:
+    // Distance and spring constraints share the same representation: a distance constraint is a spring with 0 compliance
+    struct Edge {
+        uint32_t a, b;
+        float    restLength;
+        float    compliance;
+        float    damping;
+    };
+
+    void build_colors(size_t particlesCount);
+    void substep(std::span<Particle> particles, Obstacles const& obstacles, float dt);
+    void solve_edge(Edge const& edge, float& lambda, float dt);
+    void solve_collisions(Obstacles const& obstacles, size_t particlesCount);
+
+private:
+    Settings                   _settings;
+    std::vector<Edge>          _edges{};
+    std::vector<PinConstraint> _pins{};
+
+    // Edges sorted by color: color c is [_colorStarts[c], _colorStarts[c+1]).
+    // The edges after _serialEdgesStart didn't fit in any of the 64 colors and are solved serially.
+    bool                _colorsAreDirty{true};
+    size_t              _coloredParticlesCount{0};
+    std::vector<Edge>   _coloredEdges{};
+    std::vector<size_t> _colorStarts{};
+    size_t              _serialEdgesStart{0};
+
+    // Per-substep state
+    std::vector<float>     _lambdas{};
+    std::vector<float>     _inverseMasses{};
+    std::vector<glm::vec2> _positions{};
+    std::vector<glm::vec2> _previousPositions{};
+    std::vector<glm::vec2> _contactNormals{};
+};
+
+// Creates a chain of particles linked by distance constraints. Returns the index of the first particle.
+uint32_t add_rope(std::vector<Particle>& particles, Solver& solver, glm::vec2 start, glm::vec2 end, int segmentsCount, bool pinStart = true);
+
+// Creates a grid of particles linked by structural and shear springs, pinned by its two top corners. Returns the index of the first particle.
+uint32_t add_cloth(std::vector<Particle>& particles, Solver& solver, glm::vec2 topLeft, int columns, int rows, float spacing, float stiffness = 1e4f);
+
+} // namespace pbd
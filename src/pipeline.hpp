@@ -0,0 +1,112 @@
+#pragma once
+#include <array>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include "opengl-framework/opengl-framework.hpp"
+
+// Runs a simulation on its own thread, one frame ahead of the rendering: while the main thread draws frame N
+// (and waits for the vsync in gl::window_is_open()), the simulation thread computes frame N+1 in a second copy of the state.
+// The two copies are swapped at the fence in next_frame(). The step function must not call OpenGL.
+template<typename State>
+class Pipeline {
+public:
+    using StepFunction = std::function<void(State& state, float dt)>;
+
+    Pipeline(State initialState, StepFunction step)
+        : _states{initialState, std::move(initialState)}
+        , _step{std::move(step)}
+        , _thread{[this]() { simulation_loop(); }}
+    {
+    }
+    ~Pipeline() { stop(); }
+    Pipeline(Pipeline const&)            = delete;
+    Pipeline& operator=(Pipeline const&) = delete;
+
+    // Waits for the frame being simulated, then starts simulating the next one with dt.
+    // Returns the last simulated frame, which is not modified until the next call.
+    State const& next_frame(float dt)
+    {
+        return next_frame(dt, []() {});
+    }
+
+    // Same, and calls atFence() while the simulation thread is stopped, e.g. to swap what it recorded with what the main thread used
+    template<typename Function>
+    State const& next_frame(float dt, Function&& atFence)
+    {
+        std::unique_lock lock{_mutex};
+        _fence.wait(lock, [&]() { return !_isSimulating; });
+        if (_hasNewFrame) {
+            _front       = 1 - _front;
+            _hasNewFrame = false;
+        }
+        atFence();
+        _dt           = dt;
+        _isSimulating = true;
+        lock.unlock();
+        _fence.notify_all();
+        return _states[_front];
+    }
+
+    // Waits for the simulation to end and gives back the last frame, e.g. to save it
+    State finish()
+    {
+        stop();
+        if (_hasNewFrame)
+            _front = 1 - _front;
+        return std::move(_states[_front]);
+    }
+
+private:
+    void simulation_loop()
+    {
+        while (true) {
+            std::unique_lock lock{_mutex};
+            _fence.wait(lock, [&]() { return _isSimulating || _stop; });
+            if (_stop)
+                return;
+            int const   front = _front;
+            float const dt    = _dt;
+            lock.unlock();
+
+            // The main thread only reads the front state until the next fence, so we can read it too
+            State& back = _states[1 - front];
+            back        = _states[front];
+            _step(back, dt);
+            gl::frame_arena().reset(); // End of the frame of this thread
+
+            lock.lock();
+            _isSimulating = false;
+            _hasNewFrame  = true;
+            lock.unlock();
+            _fence.notify_all();
+        }
+    }
+
+    void stop()
+    {
+        if (!_thread.joinable())
+            return;
+        {
+            std::unique_lock lock{_mutex};
+            _fence.wait(lock, [&]() { return !_isSimulating; }); // Let the current step finish, so that its frame isn't lost
+            _stop = true;
+        }
+        _fence.notify_all();
+        _thread.join();
+    }
+
+private:
+    std::array<State, 2>    _states;
+    int                     _front{0};
+    StepFunction            _step;
+    std::mutex              _mutex{};
+    std::condition_variable _fence{};
+    float                   _dt{0.f};
+    bool                    _isSimulating{false};
+    bool                    _hasNewFrame{false};
+    bool                    _stop{false};
+    std::thread             _thread; // Last, so that everything else is initialized when it starts
+};
@@ -0,0 +1,148 @@
+#include "post_processing.hpp"
+#include <algorithm>
+#include <vector>
+
+// The shaders are in res/shaders, and are reloaded when they change.
+// They compile in the background: the driver works on all the passes at the same time, and we only wait for them when they are first used.
+static gl::WatchedShader make_fullscreen_shader(gl::ShaderWatcher& shaderWatcher, const char* fragmentShaderFile)
+{
+    return shaderWatcher.watch(gl::Shader_Descriptor{
+        .vertex   = gl::ShaderSource::File{"res/shaders/fullscreen.vert"},
+        .fragment = gl::ShaderSource::File{fragmentShaderFile},
+    });
+}
+
+static auto make_target(GLsizei width, GLsizei height) -> gl::RenderTarget
+{
+    return gl::RenderTarget{gl::RenderTarget_Descriptor{
+        .width          = width,
+        .height         = height,
+        .color_textures = {gl::ColorAttachment_Descriptor{.format = gl::InternalFormat_Color::RGBA16F}},
+    }};
+}
+
+PostProcessing::PostProcessing(gl::ShaderWatcher& shaderWatcher, PostProcessing_Settings const& settings)
+    : settings{settings}
+    , _brightPassShader{make_fullscreen_shader(shaderWatcher, "res/shaders/bright_pass.frag")}
+    , _downsampleShader{make_fullscreen_shader(shaderWatcher, "res/shaders/downsample.frag")}
+    , _upsampleShader{make_fullscreen_shader(shaderWatcher, "res/shaders/upsample.frag")}
+    , _trailsShader{make_fullscreen_shader(shaderWatcher, "res/shaders/trails.frag")}
+    , _tonemapShader{make_fullscreen_shader(shaderWatcher, "res/shaders/tonemap.frag")}
+    , _trails{make_target(1, 1), make_target(1, 1)}
+{
+    glGenVertexArrays(1, &_emptyVertexArray);
+}
+
+PostProcessing::~PostProcessing()
+{
+    glDeleteVertexArrays(1, &_emptyVertexArray);
+}
+
+void PostProcessing::draw_fullscreen_triangle() const
+{
+    glBindVertexArray(_emptyVertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+}
+
+gl::RenderTarget& PostProcessing::begin_frame()
+{
+    _pool.collect_garbage();
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE); // Additive, like the rest of the app
+    return _pool.acquire(gl::framebuffer_width_in_pixels(), gl::framebuffer_height_in_pixels());
+}
+
+void PostProcessing::end_frame(gl::RenderTarget& scene)
+{
+    // The passes overwrite their target, except the upsampling which adds to it
+    glDisable(GL_BLEND);
+
+    gl::RenderTarget const& image = apply_trails(scene);
+    gl::RenderTarget* bloom = apply_bloom(image);
+
+    gl::Shader const& shader = _tonemapShader.shader();
+    shader.bind();
+    shader.set_uniform("u_image", image.color_texture(0));
+    shader.set_uniform("u_bloom", bloom != nullptr ? bloom->color_texture(0) : image.color_texture(0));
+    shader.set_uniform("u_bloom_intensity", bloom != nullptr ? settings.bloomIntensity : 0.f);
+    shader.set_uniform("u_exposure", settings.exposure);
+    draw_fullscreen_triangle();
+
+    if (bloom != nullptr)
+        _pool.release(*bloom);
+    _pool.release(scene);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+}
+
+gl::RenderTarget const& PostProcessing::apply_trails(gl::RenderTarget const& scene)
+{
+    if (settings.trailsPersistence <= 0.f)
+        return scene;
+
+    // Only reallocates (and clears the trails) when the window has been resized
+    for (auto& target : _trails)
+        target.resize(scene.width(), scene.height());
+
+    gl::RenderTarget const& previous = _trails[_currentTrails];
+    _currentTrails = 1 - _currentTrails;
+    gl::RenderTarget& current = _trails[_currentTrails];
+    current.render([&]() {
+        gl::Shader const& shader = _trailsShader.shader();
+        shader.bind();
+        shader.set_uniform("u_image", scene.color_texture(0));
+        shader.set_uniform("u_previous", previous.color_texture(0));
+        shader.set_uniform("u_persistence", std::min(settings.trailsPersistence, 0.99f));
+        draw_fullscreen_triangle();
+    });
+    return current;
+}
+
+gl::RenderTarget* PostProcessing::apply_bloom(gl::RenderTarget const& image)
+{
+    if (settings.bloomIntensity <= 0.f || settings.bloomLevels <= 0)
+        return nullptr;
+
+    // Bright pass at half resolution, then each level halves the previous one
+    std::pmr::vector<gl::RenderTarget*> levels{&gl::frame_arena()};
+    GLsizei width = std::max(image.width() / 2, 1);
+    GLsizei height = std::max(image.height() / 2, 1);
+    levels.push_back(&_pool.acquire(width, height));
+    levels.back()->render([&]() {
+        gl::Shader const& shader = _brightPassShader.shader();
+        shader.bind();
+        shader.set_uniform("u_image", image.color_texture(0));
+        shader.set_uniform("u_threshold", settings.bloomThreshold);
+        draw_fullscreen_triangle();
+    });
+    for (int i = 1; i < settings.bloomLevels && width > 1 && height > 1; ++i) {
+        gl::RenderTarget const& source = *levels.back();
+        width = std::max(width / 2, 1);
+        height = std::max(height / 2, 1);
+        levels.push_back(&_pool.acquire(width, height));
+        levels.back()->render([&]() {
+            gl::Shader const& shader = _downsampleShader.shader();
+            shader.bind();
+            shader.set_uniform("u_image", source.color_texture(0));
+            shader.set_uniform("u_texel_size", 1.f / glm::vec2{source.width(), source.height()});
+            draw_fullscreen_triangle();
+        });
+    }
+
+    // Go back up, adding each blurred level to the bigger one
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    for (size_t i = levels.size() - 1; i > 0; --i) {
+        gl::RenderTarget const& source = *levels[i];
+        levels[i - 1]->render([&]() {
+            gl::Shader const& shader = _upsampleShader.shader();
+            shader.bind();
+            shader.set_uniform("u_image", source.color_texture(0));
+            shader.set_uniform("u_texel_size", 1.f / glm::vec2{source.width(), source.height()});
+            draw_fullscreen_triangle();
+        });
+        _pool.release(source);
+    }
+    glDisable(GL_BLEND);
+    return levels.front();
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <utility>
+#include "opengl-framework/opengl-framework.hpp"
+
+struct PostProcessing_Settings {
+    float bloomThreshold{0.8f};  // Brightness above which pixels glow
+    float bloomIntensity{0.6f};  // 0 disables the bloom
+    int   bloomLevels{5};        // Each level halves the resolution and widens the glow
+    float trailsPersistence{0.f}; // Part of the previous image that stays on screen each frame, 0 disables the trails
+    float exposure{1.f};
+};
+
+// Renders the scene in a floating point target so that additive particles can go above 1,
+// then adds trails (feedback of the previous frames), bloom, and tonemaps the result to the screen.
+// All the intermediate targets come from a pool, so nothing is allocated from one frame to the next unless the window is resized.
+class PostProcessing {
+public:
+    // The shaders are in res/shaders, and are reloaded when they change
+    explicit PostProcessing(gl::ShaderWatcher& shaderWatcher, PostProcessing_Settings const& settings = {});
+    ~PostProcessing();
+    PostProcessing(PostProcessing const&)            = delete;
+    PostProcessing& operator=(PostProcessing const&) = delete;
+
+    PostProcessing_Settings settings;
+
+    // drawScene is called with an HDR target bound, already cleared to black, and with additive blending
+    template<typename DrawFn>
+    void render(DrawFn&& drawScene)
+    {
+        if (gl::framebuffer_width_in_pixels() == 0 || gl::framebuffer_height_in_pixels() == 0) { // Minimized window, we can't create targets of that size
+            std::forward<DrawFn>(drawScene)();
+            return;
+        }
+        gl::RenderTarget& scene = begin_frame();
+        scene.render([&]() {
+            glClearColor(0.f, 0.f, 0.f, 0.f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            std::forward<DrawFn>(drawScene)();
+        });
+        end_frame(scene);
+    }
+
+private:
+    gl::RenderTarget& begin_frame();
+    void end_frame(gl::RenderTarget& scene);
+
+    gl::RenderTarget const& apply_trails(gl::RenderTarget const& scene);
+    gl::RenderTarget* apply_bloom(gl::RenderTarget const& image); // Returns nullptr when bloom is disabled
+    void draw_fullscreen_triangle() const;
+
+private:
+    gl::RenderTargetPool _pool;
+    gl::WatchedShader _brightPassShader;
+    gl::WatchedShader _downsampleShader;
+    gl::WatchedShader _upsampleShader;
+    gl::WatchedShader _trailsShader;
+    gl::WatchedShader _tonemapShader;
+    GLuint _emptyVertexArray{0}; // The fullscreen triangle is generated from gl_VertexID, but OpenGL still wants a vertex array to be bound
+
+    // The trails read the previous frame while writing the new one, so they need two persistent targets
+    gl::RenderTarget _trails[2];
+    int _currentTrails{0};
+};
@@ -0,0 +1,135 @@
+#include "render_commands.hpp"
+#include <algorithm>
+#include <thread>
+#include "parallel.hpp"
+#include "particle_renderer.hpp"
+#include "utils.hpp"
+
+namespace render {
+
+// Commands are sorted by key, each field only changing once per group
+enum Shader : uint32_t {
+    ParticleShader = 0, // Particles and disks
+    LineShader     = 1,
+};
+
+static uint32_t make_key(Blend blend, Shader shader, uint16_t texture)
+{
+    return static_cast<uint32_t>(blend) << 24 | static_cast<uint32_t>(shader) << 16 | texture;
+}
+
+static Blend blend_of(uint32_t key)
+{
+    return static_cast<Blend>(key >> 24);
+}
+
+static void set_blend(Blend blend)
+{
+    glEnable(GL_BLEND);
+    if (blend == Blend::Additive)
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+    else
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+CommandBuffer::CommandBuffer()
+    : _frames{FrameCommands(parallel::thread_count() + 1), FrameCommands(parallel::thread_count() + 1)}
+    , _owner{std::this_thread::get_id()}
+{
+}
+
+uint16_t CommandBuffer::atlas_key(gl::TextureAtlas const& atlas)
+{
+    return atlas.pages_count() == 0 ? 0 : static_cast<uint16_t>(atlas.page(0).id());
+}
+
+void CommandBuffer::push(Payload const& payload, Blend blend, uint16_t texture)
+{
+    Shader const shader = std::holds_alternative<Line>(payload) ? LineShader : ParticleShader;
+    _frames[_recording][thread_slot()].commands.push_back(Command{make_key(blend, shader, texture), payload});
+}
+
+size_t CommandBuffer::thread_slot() const
+{
+    // The owner has its own slot even inside a parallel loop, where it is index 0 too, so that it never shares slot 0 with the other thread
+    if (std::this_thread::get_id() == _owner)
+        return _frames[_recording].size() - 1;
+    return parallel::thread_index();
+}
+
+size_t CommandBuffer::size() const
+{
+    size_t count = 0;
+    for (auto const& thread : _frames[_recording])
+        count += thread.commands.size();
+    return count;
+}
+
+void CommandBuffer::clear()
+{
+    for (auto& thread : _frames[_recording])
+        thread.commands.clear();
+}
+
+void CommandBuffer::swap()
+{
+    _recording = 1 - _recording;
+    // Normally already empty, unless a frame was swapped in but never submitted
+    clear();
+}
+
+void CommandBuffer::submit(ParticleRenderer& renderer)
+{
+    // Stable sort, so that commands with the same state are drawn in the order they were recorded (thread by thread)
+    _sorted.clear();
+    for (auto& thread : _frames[1 - _recording]) {
+        _sorted.insert(_sorted.end(), thread.commands.begin(), thread.commands.end());
+        thread.commands.clear();
+    }
+    std::stable_sort(_sorted.begin(), _sorted.end(), [](Command const& a, Command const& b) { return a.key < b.key; });
+
+    bool  isFirst      = true;
+    Blend currentBlend = Blend::Additive;
+    for (size_t i = 0; i < _sorted.size();) {
+        Command const& command = _sorted[i];
+        if (isFirst || blend_of(command.key) != currentBlend) {
+            currentBlend = blend_of(command.key);
+            set_blend(currentBlend);
+            isFirst = false;
+        }
+
+        if (auto const* batch = std::get_if<ParticlesBatch>(&command.payload)) {
+            if (batch->atlas != nullptr)
+                renderer.draw(batch->particles, *batch->atlas, batch->sprites);
+            else
+                renderer.draw(batch->particles);
+            ++i;
+        } else if (auto const* packedBatch = std::get_if<PackedParticlesBatch>(&command.payload)) {
+            renderer.draw(packedBatch->particles, packedBatch->tile);
+            ++i;
+        } else if (auto const* disks = std::get_if<DisksBatch>(&command.payload)) {
+            renderer.draw(disks->positions, disks->radii, disks->colors);
+            ++i;
+        } else if (std::holds_alternative<Disk>(command.payload)) {
+            // All the following disks with the same state go in the same draw call
+            _diskPositions.clear();
+            _diskRadii.clear();
+            _diskColors.clear();
+            for (; i < _sorted.size() && _sorted[i].key == command.key && std::holds_alternative<Disk>(_sorted[i].payload); ++i) {
+                Disk const& disk = std::get<Disk>(_sorted[i].payload);
+                _diskPositions.push_back(disk.center);
+                _diskRadii.push_back(disk.radius);
+                _diskColors.push_back(disk.color);
+            }
+            renderer.draw(_diskPositions, _diskRadii, _diskColors);
+        } else {
+            Line const& line = std::get<Line>(command.payload);
+            utils::draw_line(line.start, line.end, line.thickness, line.color);
+            ++i;
+        }
+    }
+    _sorted.clear();
+    set_blend(Blend::Additive);
+}
+
+} // namespace render
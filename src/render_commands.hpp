@@ -0,0 +1,115 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include <variant>
+#include <vector>
+#include "glm/glm.hpp"
+#include "opengl-framework/opengl-framework.hpp"
+#include "packed_particles.hpp"
+#include "Struct/Particles.hpp"
+
+class ParticleRenderer;
+
+// Draw requests that any thread can record, and that the main thread (the only one allowed to talk to OpenGL) submits later.
+// Each thread of the pool writes into its own buffer, so recording never takes a lock nor waits for another thread.
+// The buffers are doubled: frame N+1 can be recorded (e.g. by the simulation thread of a Pipeline) while frame N is submitted,
+// and swap() hands the recorded frame over to submit().
+// submit() merges the buffers and sorts the commands by blending mode, shader and texture, so that each state is set once.
+namespace render {
+
+enum class Blend : uint8_t {
+    Additive, // Default of the app
+    Alpha,
+};
+
+// Batch of particles. The spans are not copied: they must stay alive until submit().
+struct ParticlesBatch {
+    std::span<Particle const> particles;
+    gl::TextureAtlas const*   atlas{nullptr}; // nullptr to draw disks
+    std::span<uint32_t const> sprites{};
+};
+
+// Batch of particles in the compressed storage. The span is not copied: it must stay alive until submit().
+struct PackedParticlesBatch {
+    std::span<packed::Particle const> particles;
+    packed::Tile                      tile;
+};
+
+// Batch of disks given as separate arrays. The spans are not copied: they must stay alive until submit().
+struct DisksBatch {
+    std::span<glm::vec2 const> positions;
+    std::span<float const>     radii;
+    std::span<glm::vec4 const> colors;
+};
+
+// Debug shapes, copied in the buffer. Consecutive disks are drawn with a single call.
+struct Disk {
+    glm::vec2 center;
+    float     radius;
+    glm::vec4 color;
+};
+
+struct Line {
+    glm::vec2 start;
+    glm::vec2 end;
+    float     thickness;
+    glm::vec4 color;
+};
+
+class CommandBuffer {
+public:
+    CommandBuffer();
+
+    // Can be called from the threads of the pool (inside parallel::for_each_chunk()), from the thread that created the buffer,
+    // and from one other thread (e.g. the simulation thread of a Pipeline), at the same time as submit() but never as swap()
+    void push(ParticlesBatch const& batch, Blend blend = Blend::Additive) { push(Payload{batch}, blend, batch.atlas != nullptr ? atlas_key(*batch.atlas) : 0); }
+    void push(PackedParticlesBatch const& batch, Blend blend = Blend::Additive) { push(Payload{batch}, blend, 0); }
+    void push(DisksBatch const& batch, Blend blend = Blend::Additive) { push(Payload{batch}, blend, 0); }
+    void push(Disk const& disk, Blend blend = Blend::Additive) { push(Payload{disk}, blend, 0); }
+    void push(Line const& line, Blend blend = Blend::Additive) { push(Payload{line}, blend, 0); }
+
+    // Makes the commands recorded so far the ones of the next submit(), and starts recording a new frame.
+    // Must be called while nobody records, e.g. at the fence of Pipeline::next_frame().
+    void swap();
+
+    // Main thread only. Draws the commands of the last swap(), then clears them. Leaves the blending of the app (additive) enabled.
+    void submit(ParticleRenderer& renderer);
+    // Forgets the frame being recorded
+    void clear();
+
+    // Number of commands in the frame being recorded
+    size_t size() const;
+
+private:
+    using Payload = std::variant<ParticlesBatch, PackedParticlesBatch, DisksBatch, Disk, Line>;
+
+    struct Command {
+        uint32_t key; // Blend, then shader, then texture
+        Payload  payload;
+    };
+
+    // Padded so that two threads never write to the same cache line
+    struct alignas(64) ThreadCommands {
+        std::vector<Command> commands{};
+    };
+    using FrameCommands = std::vector<ThreadCommands>;
+
+    void push(Payload const& payload, Blend blend, uint16_t texture);
+    size_t thread_slot() const;
+    static uint16_t atlas_key(gl::TextureAtlas const& atlas);
+
+private:
+    // One slot per thread of the pool, plus one for the thread that created the buffer: parallel::thread_index() is 0
+    // for every thread outside of the pool, so it can't tell it from another one (e.g. the simulation thread)
+    std::array<FrameCommands, 2> _frames{};
+    int                          _recording{0}; // Index in _frames, the other one is submitted
+    std::thread::id              _owner{};
+    std::vector<Command>         _sorted{};
+    std::vector<glm::vec2>       _diskPositions{};
+    std::vector<float>           _diskRadii{};
+    std::vector<glm::vec4>       _diskColors{};
+};
+
+} // namespace render
@@ -0,0 +1,351 @@
+#include "replay.hpp"
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "parallel.hpp"
+
+// File layout:
+//  - FileHeader
+//  - Chunks: a ChunkHeader followed by payloadSize bytes.
+//      - Keyframe / Delta: the channels of all the particles (x, y, radius, r, g, b, a), channel by channel.
+//        Each value is stored as the zigzag varint of its difference with the previous frame (with 0 for keyframes).
+//      - Index: for each frame, the uint64 offset of its chunk.
+//  - Footer, pointing to the index chunk
+// Everything is little-endian.
+
+static_assert(std::endian::native == std::endian::little, "Recordings are stored in little-endian");
+
+namespace replay {
+
+namespace {
+constexpr std::array<char, 8> fileMagic{'P', 'T', 'C', 'L', 'R', 'P', 'L', 'Y'};
+constexpr std::array<char, 8> footerMagic{'R', 'P', 'L', 'Y', 'I', 'N', 'D', 'X'};
+constexpr uint32_t            version       = 1;
+constexpr size_t              channelsCount = 7;
+
+enum ChunkType : uint32_t {
+    Keyframe = 1,
+    Delta    = 2,
+    Index    = 3,
+};
+
+struct FileHeader {
+    std::array<char, 8> magic;
+    uint32_t            version;
+    float               positionStep;
+};
+
+struct ChunkHeader {
+    uint32_t type;
+    uint32_t particlesCount;
+    uint64_t frame;
+    uint64_t payloadSize;
+    float    deltaTime;
+    uint32_t reserved;
+};
+
+struct Footer {
+    uint64_t            indexOffset;
+    std::array<char, 8> magic;
+};
+
+static_assert(std::is_trivially_copyable_v<FileHeader> && sizeof(FileHeader) == 16);
+static_assert(std::is_trivially_copyable_v<ChunkHeader> && sizeof(ChunkHeader) == 32);
+static_assert(std::is_trivially_copyable_v<Footer> && sizeof(Footer) == 16);
+} // namespace
+
+// ------ Encoding ------
+
+static void write_varint(std::vector<uint8_t>& out, int32_t value)
+{
+    // Zigzag so that small negative values are small too
+    uint32_t v = (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+static bool read_varint(uint8_t const*& it, uint8_t const* end, int32_t& value)
+{
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (it == end)
+            return false;
+        uint8_t const byte = *it++;
+        v |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            value = static_cast<int32_t>((v >> 1) ^ (~(v & 1) + 1));
+            return true;
+        }
+    }
+    return false;
+}
+
+static int32_t quantize(float value, float step)
+{
+    return static_cast<int32_t>(std::lround(value / step));
+}
+
+static int32_t to_byte(float value)
+{
+    return static_cast<int32_t>(std::lround(glm::clamp(value, 0.f, 1.f) * 255.f));
+}
+
+// ------ Recorder ------
+
+Recorder::Recorder(std::filesystem::path const& path, Settings const& settings)
+    : _settings{settings}
+    , _path{path}
+    , _file{path, std::ios::binary | std::ios::trunc}
+{
+    if (!_file)
+        throw std::runtime_error{"[replay] Failed to create \"" + path.string() + "\""};
+
+    FileHeader header{};
+    header.magic        = fileMagic;
+    header.version      = version;
+    header.positionStep = _settings.positionStep;
+    _file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    if (!_file)
+        throw std::runtime_error{"[replay] Failed to write \"" + path.string() + "\""};
+    _offset = sizeof(header);
+
+    _thread = std::thread{[this]() { write_loop(); }};
+}
+
+Recorder::~Recorder()
+{
+    {
+        std::scoped_lock lock{_mutex};
+        _stopping = true;
+    }
+    _queueChanged.notify_all();
+    _thread.join();
+    if (_writeFailed)
+        return;
+
+    ChunkHeader chunk{};
+    chunk.type        = Index;
+    chunk.frame       = _indexOffsets.size();
+    chunk.payloadSize = _indexOffsets.size() * sizeof(uint64_t);
+    Footer footer{};
+    footer.indexOffset = _offset;
+    footer.magic       = footerMagic;
+    _file.write(reinterpret_cast<char const*>(&chunk), sizeof(chunk));
+    _file.write(reinterpret_cast<char const*>(_indexOffsets.data()), static_cast<std::streamsize>(chunk.payloadSize));
+    _file.write(reinterpret_cast<char const*>(&footer), sizeof(footer));
+    _file.close();
+    if (!_file)
+        std::cerr << "[replay] Failed to write the index of \"" + _path.string() + "\", the recording can't be played\n";
+}
+
+void Recorder::record(std::span<Particle const> particles, float deltaTime)
+{
+    PendingFrame frame;
+    {
+        std::unique_lock lock{_mutex};
+        _queueChanged.wait(lock, [&]() { return _queue.size() < static_cast<size_t>(_settings.queueCapacity); });
+        if (!_freeFrames.empty()) {
+            frame = std::move(_freeFrames.back());
+            _freeFrames.pop_back();
+        }
+    }
+
+    size_t const count = particles.size();
+    frame.particlesCount = static_cast<uint32_t>(count);
+    frame.deltaTime      = deltaTime;
+    frame.channels.resize(count * channelsCount);
+    int32_t* channels = frame.channels.data();
+    float const step = _settings.positionStep;
+    parallel::for_each_index(count, [&](size_t i) {
+        auto const& particle = particles[i];
+        auto const  color    = particle.color();
+        channels[0 * count + i] = quantize(particle.position.x, step);
+        channels[1 * count + i] = quantize(particle.position.y, step);
+        channels[2 * count + i] = quantize(particle.radius(), step);
+        channels[3 * count + i] = to_byte(color.r);
+        channels[4 * count + i] = to_byte(color.g);
+        channels[5 * count + i] = to_byte(color.b);
+        channels[6 * count + i] = to_byte(color.a);
+    });
+
+    {
+        std::scoped_lock lock{_mutex};
+        _queue.push_back(std::move(frame));
+    }
+    _queueChanged.notify_all();
+    ++_framesCount;
+}
+
+void Recorder::write_loop()
+{
+    while (true) {
+        PendingFrame frame;
+        {
+            std::unique_lock lock{_mutex};
+            _queueChanged.wait(lock, [&]() { return _stopping || !_queue.empty(); });
+            if (_queue.empty())
+                return; // Stopping, and everything has been written
+            frame = std::move(_queue.front());
+            _queue.pop_front();
+        }
+        _queueChanged.notify_all(); // There is room in the queue again
+
+        write_frame(frame);
+
+        std::scoped_lock lock{_mutex};
+        _freeFrames.push_back(std::move(frame));
+    }
+}
+
+void Recorder::write_frame(PendingFrame const& frame)
+{
+    if (_writeFailed)
+        return;
+    bool const isKeyframe = _writtenFrames % static_cast<uint64_t>(std::max(_settings.keyframeInterval, 1)) == 0
+                            || _previousChannels.size() != frame.channels.size();
+    if (isKeyframe)
+        _previousChannels.assign(frame.channels.size(), 0);
+
+    _encoded.clear();
+    for (size_t i = 0; i < frame.channels.size(); ++i)
+        write_varint(_encoded, frame.channels[i] - _previousChannels[i]);
+    _previousChannels = frame.channels;
+
+    ChunkHeader chunk{};
+    chunk.type           = isKeyframe ? Keyframe : Delta;
+    chunk.particlesCount = frame.particlesCount;
+    chunk.frame          = _writtenFrames;
+    chunk.payloadSize    = _encoded.size();
+    chunk.deltaTime      = frame.deltaTime;
+    _file.write(reinterpret_cast<char const*>(&chunk), sizeof(chunk));
+    _file.write(reinterpret_cast<char const*>(_encoded.data()), static_cast<std::streamsize>(_encoded.size()));
+    if (isKeyframe)
+        _file.flush(); // So that a crash loses at most one keyframe interval
+    if (!_file) {
+        std::cerr << "[replay] Failed to write frame " + std::to_string(_writtenFrames) + " to \"" + _path.string() + "\", the recording stops there\n";
+        _writeFailed = true;
+        return;
+    }
+
+    _indexOffsets.push_back(_offset);
+    _offset += sizeof(chunk) + _encoded.size();
+    ++_writtenFrames;
+}
+
+// ------ Player ------
+
+Player::Player(std::filesystem::path const& path)
+    : _file{path}
+{
+    auto const bytes = _file.bytes();
+    auto const fail = [&](char const* reason) {
+        throw std::runtime_error{"[replay] Invalid recording \"" + path.string() + "\": " + reason};
+    };
+
+    FileHeader header;
+    if (bytes.size() < sizeof(header))
+        fail("file too small");
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != fileMagic)
+        fail("not a recording");
+    if (header.version != version)
+        fail("unsupported version");
+    _positionStep = header.positionStep;
+
+    auto const read_chunk = [&](uint64_t offset, ChunkHeader& chunk) {
+        if (offset > bytes.size() || bytes.size() - offset < sizeof(chunk))
+            return false;
+        std::memcpy(&chunk, bytes.data() + offset, sizeof(chunk));
+        return chunk.payloadSize <= bytes.size() - offset - sizeof(chunk);
+    };
+
+    // Index written by the recorder
+    Footer footer;
+    ChunkHeader chunk;
+    if (bytes.size() >= sizeof(header) + sizeof(footer)) {
+        std::memcpy(&footer, bytes.data() + bytes.size() - sizeof(footer), sizeof(footer));
+        if (footer.magic == footerMagic && read_chunk(footer.indexOffset, chunk) && chunk.type == Index
+            && chunk.payloadSize == chunk.frame * sizeof(uint64_t)) {
+            _offsets.resize(static_cast<size_t>(chunk.frame));
+            std::memcpy(_offsets.data(), bytes.data() + footer.indexOffset + sizeof(chunk), static_cast<size_t>(chunk.payloadSize));
+        }
+    }
+    // Otherwise the recording was interrupted: walk through the chunks, up to the last complete one
+    if (_offsets.empty()) {
+        uint64_t offset = sizeof(header);
+        while (read_chunk(offset, chunk) && (chunk.type == Keyframe || chunk.type == Delta)) {
+            _offsets.push_back(offset);
+            offset += sizeof(chunk) + chunk.payloadSize;
+        }
+    }
+
+    _keyframes.resize(_offsets.size());
+    uint32_t keyframe = 0;
+    for (size_t i = 0; i < _offsets.size(); ++i) {
+        if (!read_chunk(_offsets[i], chunk) || (chunk.type != Keyframe && chunk.type != Delta))
+            fail("corrupted index");
+        if (chunk.type == Keyframe)
+            keyframe = static_cast<uint32_t>(i);
+        else if (i == 0)
+            fail("first frame is not a keyframe");
+        _keyframes[i] = keyframe;
+    }
+}
+
+void Player::decode(size_t frameIndex)
+{
+    ChunkHeader chunk;
+    std::memcpy(&chunk, _file.bytes().data() + _offsets[frameIndex], sizeof(chunk));
+    auto const* it  = reinterpret_cast<uint8_t const*>(_file.bytes().data() + _offsets[frameIndex] + sizeof(chunk));
+    auto const* end = it + chunk.payloadSize;
+
+    size_t const valuesCount = size_t{chunk.particlesCount} * channelsCount;
+    if (chunk.type == Keyframe)
+        _channels.assign(valuesCount, 0);
+    else if (_channels.size() != valuesCount)
+        throw std::runtime_error{"[replay] Corrupted delta frame " + std::to_string(frameIndex)};
+
+    for (auto& value : _channels) {
+        int32_t delta;
+        if (!read_varint(it, end, delta))
+            throw std::runtime_error{"[replay] Corrupted frame " + std::to_string(frameIndex)};
+        value += delta;
+    }
+    _frame.deltaTime = chunk.deltaTime;
+    _currentFrame = frameIndex;
+}
+
+Frame const& Player::seek(size_t frameIndex)
+{
+    if (frameIndex >= _offsets.size())
+        throw std::runtime_error{"[replay] Frame " + std::to_string(frameIndex) + " is out of range"};
+
+    // Keep going from the current frame when it is on the way, otherwise restart from the keyframe
+    size_t first = _keyframes[frameIndex];
+    if (_currentFrame != SIZE_MAX && _currentFrame <= frameIndex && _currentFrame >= first)
+        first = _currentFrame + 1;
+    for (size_t i = first; i <= frameIndex; ++i)
+        decode(i);
+
+    size_t const count = _channels.size() / channelsCount;
+    _frame.positions.resize(count);
+    _frame.radii.resize(count);
+    _frame.colors.resize(count);
+    int32_t const* channels = _channels.data();
+    parallel::for_each_index(count, [&](size_t i) {
+        _frame.positions[i] = glm::vec2{static_cast<float>(channels[0 * count + i]), static_cast<float>(channels[1 * count + i])} * _positionStep;
+        _frame.radii[i]     = static_cast<float>(channels[2 * count + i]) * _positionStep;
+        _frame.colors[i]    = glm::vec4{channels[3 * count + i], channels[4 * count + i], channels[5 * count + i], channels[6 * count + i]} / 255.f;
+    });
+    return _frame;
+}
+
+} // namespace replay
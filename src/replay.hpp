@@ -0,0 +1,107 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+#include "glm/glm.hpp"
+#include "mapped_file.hpp"
+#include "Struct/Particles.hpp"
+
+// Recording of the rendered state of the particles (position, radius and color), frame by frame.
+// Values are quantized when recorded, so playing a recording gives back exactly the same frames on every machine.
+// A file is a header followed by chunks appended one after the other: keyframes store the full state, the other
+// frames only store the difference with the previous one. The recorder ends the file with an index of all the frames;
+// if it never got the chance to (crash), the player rebuilds the index by walking through the chunks.
+namespace replay {
+
+struct Settings {
+    int   keyframeInterval{60};   // Number of frames between two full frames, which is also the maximum number of frames decoded by a seek
+    float positionStep{1e-5f};    // Quantization of positions and radii
+    int   queueCapacity{8};       // Frames waiting to be written. record() only blocks if the disk falls this far behind.
+};
+
+// Frame given back by the player, ready to be drawn
+struct Frame {
+    std::vector<glm::vec2> positions;
+    std::vector<float>     radii;
+    std::vector<glm::vec4> colors;
+    float                  deltaTime{0.f};
+};
+
+// Records frames to a file. Encoding and writing happen on a background thread.
+class Recorder {
+public:
+    // Throws a std::runtime_error if the file can't be created
+    explicit Recorder(std::filesystem::path const& path, Settings const& settings = {});
+    // Writes the remaining frames and the index. Write errors (e.g. a full disk) are printed to std::cerr, the recording then stops.
+    ~Recorder();
+    Recorder(Recorder const&)            = delete;
+    Recorder& operator=(Recorder const&) = delete;
+
+    // Quantizes the particles on the calling thread and queues them for writing
+    void record(std::span<Particle const> particles, float deltaTime);
+
+    size_t frames_count() const { return _framesCount; }
+
+private:
+    struct PendingFrame {
+        std::vector<int32_t> channels;
+        uint32_t             particlesCount{0};
+        float                deltaTime{0.f};
+    };
+
+    void write_loop();
+    void write_frame(PendingFrame const& frame);
+
+private:
+    Settings              _settings;
+    std::filesystem::path _path;
+    std::ofstream         _file;
+    size_t                _framesCount{0};
+
+    // Owned by the writing thread
+    std::vector<int32_t>  _previousChannels;
+    std::vector<uint8_t>  _encoded;
+    uint64_t              _offset{0};
+    uint64_t              _writtenFrames{0};
+    std::vector<uint64_t> _indexOffsets;
+    bool                  _writeFailed{false}; // The next frames are dropped, and the file is left without index
+
+    std::mutex                _mutex;
+    std::condition_variable   _queueChanged;
+    std::deque<PendingFrame>  _queue;
+    std::vector<PendingFrame> _freeFrames; // Recycled so that recording doesn't allocate once warmed up
+    bool                      _stopping{false};
+    std::thread               _thread;
+};
+
+class Player {
+public:
+    // Throws a std::runtime_error if the file isn't a valid recording
+    explicit Player(std::filesystem::path const& path);
+
+    size_t frames_count() const { return _offsets.size(); }
+
+    // Decodes the given frame. Playing frames in order only decodes one delta per frame,
+    // jumping decodes from the closest keyframe before the frame.
+    Frame const& seek(size_t frameIndex);
+
+private:
+    void decode(size_t frameIndex);
+
+private:
+    MappedFile            _file;
+    float                 _positionStep{};
+    std::vector<uint64_t> _offsets;       // Offset of the chunk of each frame
+    std::vector<uint32_t> _keyframes;     // Index of the keyframe each frame starts decoding from
+    std::vector<int32_t>  _channels;      // Quantized state of the current frame
+    size_t                _currentFrame{SIZE_MAX};
+    Frame                 _frame;
+};
+
+} // namespace replay
@@ -0,0 +1,267 @@
+#include "scene_loader.hpp"
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include "mapped_file.hpp"
+#include "opengl-framework/opengl-framework.hpp"
+
+namespace scene {
+
+static void add_polyline(Obstacles& obstacles, std::span<glm::vec2 const> points, bool closed)
+{
+    for (size_t i = 0; i + 1 < points.size(); ++i)
+        obstacles.lines.push_back({points[i], points[i + 1]});
+    if (closed && points.size() > 2)
+        obstacles.lines.push_back({points.back(), points.front()});
+}
+
+static Obstacles load_obj(std::filesystem::path const& path)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warning;
+    std::string error;
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &error, path.string().c_str(), nullptr, /*triangulate=*/false))
+        throw std::runtime_error{"[scene] Failed to load \"" + path.string() + "\":\n" + error};
+
+    auto const vertex = [&](tinyobj::index_t index) {
+        auto const i = static_cast<size_t>(index.vertex_index) * 3;
+        return glm::vec2{attrib.vertices[i], attrib.vertices[i + 1]};
+    };
+
+    Obstacles obstacles;
+    std::vector<glm::vec2> points;
+    for (const auto& shape : shapes) {
+        size_t offset = 0;
+        for (int count : shape.lines.num_line_vertices) {
+            points.clear();
+            for (int k = 0; k < count; ++k)
+                points.push_back(vertex(shape.lines.indices[offset + static_cast<size_t>(k)]));
+            add_polyline(obstacles, points, false);
+            offset += static_cast<size_t>(count);
+        }
+        offset = 0;
+        for (unsigned int count : shape.mesh.num_face_vertices) {
+            points.clear();
+            for (unsigned int k = 0; k < count; ++k)
+                points.push_back(vertex(shape.mesh.indices[offset + k]));
+            add_polyline(obstacles, points, true);
+            offset += count;
+        }
+    }
+    return obstacles;
+}
+
+static Obstacles load_text(std::filesystem::path const& path)
+{
+    auto file = std::ifstream{path};
+    if (!file)
+        throw std::runtime_error{"[scene] Failed to open \"" + path.string() + "\""};
+
+    Obstacles obstacles;
+    std::vector<glm::vec2> points;
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber) {
+        auto stream = std::istringstream{line};
+        std::string kind;
+        if (!(stream >> kind) || kind.front() == '#')
+            continue;
+
+        bool valid = false;
+        if (kind == "line") {
+            Line l;
+            valid = static_cast<bool>(stream >> l.p1.x >> l.p1.y >> l.p2.x >> l.p2.y);
+            if (valid)
+                obstacles.lines.push_back(l);
+        } else if (kind == "circle") {
+            Circle c;
+            valid = static_cast<bool>(stream >> c.center.x >> c.center.y >> c.radius) && c.radius > 0.f;
+            if (valid)
+                obstacles.circles.push_back(c);
+        } else if (kind == "polyline" || kind == "polygon") {
+            size_t count = 0;
+            valid = static_cast<bool>(stream >> count) && count >= 2;
+            points.resize(valid ? count : 0);
+            for (auto& point : points)
+                valid = valid && static_cast<bool>(stream >> point.x >> point.y);
+            if (valid)
+                add_polyline(obstacles, points, kind == "polygon");
+        }
+
+        if (!valid)
+            throw std::runtime_error{"[scene] Invalid obstacle at line " + std::to_string(lineNumber) + " of \"" + path.string() + "\": " + line};
+    }
+    return obstacles;
+}
+
+Obstacles load_obstacles(std::filesystem::path const& path)
+{
+    auto const absolutePath = gl::make_absolute_path(path);
+    if (absolutePath.extension() == ".obj")
+        return load_obj(absolutePath);
+    return load_text(absolutePath);
+}
+
+// ------ Binary cache ------
+// Header, followed by the arrays of lines, circles, broadphase cell starts and broadphase items, in that order.
+// Everything is stored in the native little-endian layout so that the file can be used as is once mapped.
+
+static_assert(std::endian::native == std::endian::little, "The scene cache is stored in little-endian");
+static_assert(std::is_trivially_copyable_v<Line> && sizeof(Line) == 16);
+static_assert(std::is_trivially_copyable_v<Circle> && sizeof(Circle) == 12);
+
+namespace {
+constexpr std::array<char, 8> cacheMagic{'P', 'T', 'C', 'L', 'S', 'C', 'N', '\0'};
+constexpr uint32_t            cacheVersion = 1;
+
+struct CacheHeader {
+    std::array<char, 8> magic;
+    uint32_t            version;
+    float               cellSize;
+    uint64_t            sourceSize;
+    int64_t             sourceWriteTime;
+    float               min[2];
+    float               max[2];
+    int32_t             resolution[2];
+    uint64_t            linesCount;
+    uint64_t            circlesCount;
+    uint64_t            cellStartsCount;
+    uint64_t            itemsCount;
+};
+static_assert(std::is_trivially_copyable_v<CacheHeader> && sizeof(CacheHeader) % 8 == 0);
+} // namespace
+
+static CacheHeader make_header(std::filesystem::path const& source, float cellSize)
+{
+    CacheHeader header{};
+    header.magic = cacheMagic;
+    header.version = cacheVersion;
+    header.cellSize = cellSize;
+    header.sourceSize = static_cast<uint64_t>(std::filesystem::file_size(source));
+    header.sourceWriteTime = static_cast<int64_t>(std::filesystem::last_write_time(source).time_since_epoch().count());
+    return header;
+}
+
+template<typename T>
+static std::vector<T> read_array(std::span<std::byte const> bytes, size_t& offset, uint64_t count)
+{
+    std::vector<T> result(static_cast<size_t>(count));
+    std::memcpy(result.data(), bytes.data() + offset, result.size() * sizeof(T));
+    offset += result.size() * sizeof(T);
+    return result;
+}
+
+static bool try_read_cache(std::filesystem::path const& cachePath, CacheHeader const& expected, Scene& scene)
+{
+    if (!std::filesystem::exists(cachePath))
+        return false;
+    MappedFile file;
+    try {
+        file = MappedFile{cachePath};
+    } catch (std::exception const&) {
+        return false; // E.g. locked by another instance: the cache is simply rebuilt
+    }
+    auto const bytes = file.bytes();
+
+    CacheHeader header;
+    if (bytes.size() < sizeof(header))
+        return false; // E.g. empty
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != expected.magic || header.version != expected.version || header.cellSize != expected.cellSize
+        || header.sourceSize != expected.sourceSize || header.sourceWriteTime != expected.sourceWriteTime)
+        return false; // Stale or from another version of the program
+
+    // Each array must fit in the file on its own, which also keeps the total size below from overflowing
+    auto const fits = [&](uint64_t count, size_t elementSize) { return count <= bytes.size() / elementSize; };
+    if (!fits(header.linesCount, sizeof(Line)) || !fits(header.circlesCount, sizeof(Circle))
+        || !fits(header.cellStartsCount, sizeof(uint32_t)) || !fits(header.itemsCount, sizeof(uint32_t)))
+        return false; // Corrupted
+    uint64_t const expectedSize = sizeof(header) + header.linesCount * sizeof(Line) + header.circlesCount * sizeof(Circle)
+                                  + (header.cellStartsCount + header.itemsCount) * sizeof(uint32_t);
+    if (bytes.size() != expectedSize)
+        return false; // Truncated
+
+    // One start per cell, plus the end of the last one (or nothing at all if there are no obstacles)
+    int32_t const resolutionX = header.resolution[0];
+    int32_t const resolutionY = header.resolution[1];
+    bool const hasCells = resolutionX > 0 && resolutionY > 0;
+    if (header.cellStartsCount != (hasCells ? static_cast<uint64_t>(resolutionX) * static_cast<uint64_t>(resolutionY) + 1 : 0))
+        return false; // Corrupted
+
+    size_t offset = sizeof(header);
+    scene.obstacles.lines = read_array<Line>(bytes, offset, header.linesCount);
+    scene.obstacles.circles = read_array<Circle>(bytes, offset, header.circlesCount);
+    auto cellStarts = read_array<uint32_t>(bytes, offset, header.cellStartsCount);
+    auto items = read_array<uint32_t>(bytes, offset, header.itemsCount);
+    scene.broadphase = collision::Broadphase{
+        {header.min[0], header.min[1]}, {header.max[0], header.max[1]}, header.cellSize,
+        {header.resolution[0], header.resolution[1]}, std::move(cellStarts), std::move(items)
+    };
+    // The grid gives indices in the obstacles without checking them
+    if (!scene.broadphase.is_valid(scene.obstacles.lines.size(), scene.obstacles.circles.size())) {
+        scene = {};
+        return false; // Corrupted
+    }
+    return true;
+}
+
+static void write_cache(std::filesystem::path const& cachePath, CacheHeader header, Scene const& scene)
+{
+    auto const& broadphase = scene.broadphase;
+    header.min[0] = broadphase.min().x;
+    header.min[1] = broadphase.min().y;
+    header.max[0] = broadphase.max().x;
+    header.max[1] = broadphase.max().y;
+    header.resolution[0] = broadphase.resolution().x;
+    header.resolution[1] = broadphase.resolution().y;
+    header.linesCount = scene.obstacles.lines.size();
+    header.circlesCount = scene.obstacles.circles.size();
+    header.cellStartsCount = broadphase.cell_starts().size();
+    header.itemsCount = broadphase.items().size();
+
+    // Written next to the final file then renamed, so that a crash never leaves a half-written cache behind
+    auto tempPath = cachePath;
+    tempPath += ".tmp";
+    {
+        auto file = std::ofstream{tempPath, std::ios::binary | std::ios::trunc};
+        auto const write = [&](void const* data, size_t size) { file.write(static_cast<char const*>(data), static_cast<std::streamsize>(size)); };
+        write(&header, sizeof(header));
+        write(scene.obstacles.lines.data(), scene.obstacles.lines.size() * sizeof(Line));
+        write(scene.obstacles.circles.data(), scene.obstacles.circles.size() * sizeof(Circle));
+        write(broadphase.cell_starts().data(), broadphase.cell_starts().size_bytes());
+        write(broadphase.items().data(), broadphase.items().size_bytes());
+        if (!file) {
+            std::cerr << "[scene] Failed to write the cache \"" << tempPath.string() << "\"\n";
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+    if (error)
+        std::cerr << "[scene] Failed to write the cache \"" << cachePath.string() << "\": " << error.message() << '\n';
+}
+
+Scene load_scene(std::filesystem::path const& path, float broadphaseCellSize)
+{
+    auto const absolutePath = gl::make_absolute_path(path);
+    auto cachePath = absolutePath;
+    cachePath += ".cache";
+
+    auto const header = make_header(absolutePath, broadphaseCellSize);
+    Scene scene;
+    if (try_read_cache(cachePath, header, scene))
+        return scene;
+
+    scene.obstacles = load_obstacles(absolutePath);
+    scene.broadphase = collision::Broadphase{scene.obstacles, broadphaseCellSize};
+    write_cache(cachePath, header, scene);
+    return scene;
+}
+
+} // namespace scene
@@ -0,0 +1,29 @@
+#pragma once
+#include <filesystem>
+#include "collision.hpp"
+#include "Struct/Obstacles.hpp"
+
+namespace scene {
+
+struct Scene {
+    Obstacles             obstacles;
+    collision::Broadphase broadphase;
+};
+
+// Parses obstacles from a file. Only the x and y coordinates are used.
+//  - .obj: the lines ("l") become polylines and the faces ("f") become closed polygons
+//  - anything else is read as a text file with one obstacle per line:
+//        line x1 y1 x2 y2
+//        polyline n x1 y1 ... xn yn
+//        polygon n x1 y1 ... xn yn     (closed polyline)
+//        circle x y radius
+//    Empty lines and lines starting with # are ignored.
+// Relative paths are relative to the executable, like the rest of the resources.
+// Throws a std::runtime_error if the file can't be read or is invalid.
+Obstacles load_obstacles(std::filesystem::path const& path);
+
+// Loads the obstacles and builds their broadphase, going through a binary cache stored next to the file (path + ".cache").
+// The cache is memory-mapped and copied as is, so it is only parsed and built once per version of the source file.
+Scene load_scene(std::filesystem::path const& path, float broadphaseCellSize);
+
+} // namespace scene
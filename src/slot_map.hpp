@@ -0,0 +1,155 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+// Reference to a value of a SlotMap that stays valid when other values are added or removed.
+// Once its value has been removed, the handle is detected as stale (the generation of its slot has changed), even if the slot has been reused since.
+struct SlotHandle {
+    uint32_t index{std::numeric_limits<uint32_t>::max()};
+    uint32_t generation{0};
+
+    bool operator==(SlotHandle const&) const = default;
+};
+
+// Stores values contiguously, like a std::vector, but hands out stable handles to them.
+// Insertion and removal are O(1): a removed value is replaced by the last one, and a table of slots keeps track of where each value went.
+// Iterating over values() is exactly iterating over a std::vector, without any hole or indirection.
+template<typename T>
+class SlotMap {
+public:
+    SlotMap() = default;
+    // Takes all the values at once, value i gets the handle {i, 0}
+    explicit SlotMap(std::vector<T> values)
+        : _values{std::move(values)}
+    {
+        _slots.resize(_values.size());
+        _slotOfValue.resize(_values.size());
+        for (uint32_t i = 0; i < _values.size(); ++i) {
+            _slots[i].valueIndex = i;
+            _slotOfValue[i]      = i;
+        }
+    }
+
+    template<typename... Args>
+    SlotHandle emplace(Args&&... args)
+    {
+        uint32_t const valueIndex = static_cast<uint32_t>(_values.size());
+        _values.emplace_back(std::forward<Args>(args)...);
+        uint32_t slotIndex;
+        if (_firstFreeSlot != noSlot) {
+            slotIndex      = _firstFreeSlot;
+            _firstFreeSlot = _slots[slotIndex].valueIndex;
+        } else {
+            slotIndex = static_cast<uint32_t>(_slots.size());
+            _slots.emplace_back();
+        }
+        _slots[slotIndex].valueIndex = valueIndex;
+        _slotOfValue.push_back(slotIndex);
+        return SlotHandle{slotIndex, _slots[slotIndex].generation};
+    }
+    SlotHandle insert(T value) { return emplace(std::move(value)); }
+
+    // Does nothing if the handle is stale
+    void erase(SlotHandle handle)
+    {
+        if (contains(handle))
+            erase_at(_slots[handle.index].valueIndex);
+    }
+
+    // Removes all the values for which predicate(value) is true, in a single pass
+    template<typename Predicate>
+    size_t erase_if(Predicate&& predicate)
+    {
+        size_t const oldSize = _values.size();
+        for (size_t i = 0; i < _values.size();) {
+            if (predicate(_values[i]))
+                erase_at(static_cast<uint32_t>(i)); // The last value moves to i, so we check i again
+            else
+                ++i;
+        }
+        return oldSize - _values.size();
+    }
+
+    bool contains(SlotHandle handle) const { return handle.index < _slots.size() && _slots[handle.index].generation == handle.generation; }
+
+    // nullptr if the handle is stale. The pointer is invalidated by any insertion or removal.
+    T* get(SlotHandle handle) { return contains(handle) ? &_values[_slots[handle.index].valueIndex] : nullptr; }
+    T const* get(SlotHandle handle) const { return contains(handle) ? &_values[_slots[handle.index].valueIndex] : nullptr; }
+
+    T& operator[](SlotHandle handle)
+    {
+        assert(contains(handle) && "Stale handle: the value has been removed");
+        return _values[_slots[handle.index].valueIndex];
+    }
+    T const& operator[](SlotHandle handle) const
+    {
+        assert(contains(handle) && "Stale handle: the value has been removed");
+        return _values[_slots[handle.index].valueIndex];
+    }
+
+    // Handle of values()[index]
+    SlotHandle handle_at(size_t index) const
+    {
+        uint32_t const slotIndex = _slotOfValue[index];
+        return SlotHandle{slotIndex, _slots[slotIndex].generation};
+    }
+
+    // All the values, in no particular order (removals move the last value into the hole)
+    std::span<T>       values() { return _values; }
+    std::span<T const> values() const { return _values; }
+    auto begin() { return _values.begin(); }
+    auto end() { return _values.end(); }
+    auto begin() const { return _values.begin(); }
+    auto end() const { return _values.end(); }
+
+    size_t size() const { return _values.size(); }
+    bool   empty() const { return _values.empty(); }
+    void   reserve(size_t capacity)
+    {
+        _values.reserve(capacity);
+        _slotOfValue.reserve(capacity);
+        _slots.reserve(capacity);
+    }
+    // Invalidates all the handles
+    void clear()
+    {
+        while (!_values.empty())
+            erase_at(static_cast<uint32_t>(_values.size() - 1));
+    }
+
+private:
+    void erase_at(uint32_t valueIndex)
+    {
+        uint32_t const slotIndex = _slotOfValue[valueIndex];
+        uint32_t const lastIndex = static_cast<uint32_t>(_values.size() - 1);
+        if (valueIndex != lastIndex) {
+            _values[valueIndex]                         = std::move(_values[lastIndex]);
+            _slotOfValue[valueIndex]                    = _slotOfValue[lastIndex];
+            _slots[_slotOfValue[valueIndex]].valueIndex = valueIndex;
+        }
+        _values.pop_back();
+        _slotOfValue.pop_back();
+
+        Slot& slot = _slots[slotIndex];
+        slot.generation++; // Makes all the existing handles to this slot stale
+        slot.valueIndex = _firstFreeSlot;
+        _firstFreeSlot  = slotIndex;
+    }
+
+private:
+    static constexpr uint32_t noSlot = std::numeric_limits<uint32_t>::max();
+
+    struct Slot {
+        uint32_t valueIndex{0}; // Index in _values, or next free slot when the slot is free
+        uint32_t generation{0};
+    };
+
+    std::vector<T>        _values{};
+    std::vector<uint32_t> _slotOfValue{}; // Slot pointing to each value, to update it when the value moves
+    std::vector<Slot>     _slots{};
+    uint32_t              _firstFreeSlot{noSlot};
+};
@@ -0,0 +1,319 @@
+#include "snapshot.hpp"
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <type_traits>
+#include "parallel.hpp"
+#if defined(PARTICLES_HAS_ZSTD)
+#include <zstd.h>
+#endif
+
+// File layout:
+//  - Header
+//  - Table of sections (one per particle attribute, plus the lines and the circles)
+//  - The sections, each starting on a 64 bytes boundary so that the mapped arrays are correctly aligned for SIMD loads.
+// A compressed section is split in blocks that are compressed independently (and decompressed in parallel):
+//  - uint64 number of blocks, then the compressed size of each block as uint64, then the blocks one after the other.
+
+static_assert(std::endian::native == std::endian::little, "Snapshots are stored in little-endian");
+static_assert(std::is_trivially_copyable_v<glm::vec2> && sizeof(glm::vec2) == 8);
+static_assert(std::is_trivially_copyable_v<glm::vec4> && sizeof(glm::vec4) == 16);
+static_assert(std::is_trivially_copyable_v<Line> && sizeof(Line) == 16);
+static_assert(std::is_trivially_copyable_v<Circle> && sizeof(Circle) == 12);
+
+namespace snapshot {
+
+namespace {
+constexpr std::array<char, 8> magic{'P', 'T', 'C', 'L', 'S', 'N', 'A', 'P'};
+constexpr uint32_t            version          = 1;
+constexpr uint32_t            compressedFlag   = 1u << 0;
+constexpr uint64_t            sectionAlignment = 64;
+constexpr uint64_t            blockSize        = 1 << 20;
+
+enum Section : uint32_t {
+    Positions,
+    Velocities,
+    Masses,
+    Lifetimes,
+    Ages,
+    StartRadii,
+    StartColors,
+    EndColors,
+    Lines,
+    Circles,
+};
+
+struct Header {
+    std::array<char, 8> magic;
+    uint32_t            version;
+    uint32_t            flags;
+    uint64_t            particlesCount;
+    uint64_t            linesCount;
+    uint64_t            circlesCount;
+    uint64_t            blockSize;
+    uint32_t            sectionsCount;
+    uint32_t            reserved;
+};
+
+struct SectionEntry {
+    uint32_t id;
+    uint32_t elementSize;
+    uint64_t offset;
+    uint64_t storedSize;
+    uint64_t rawSize;
+};
+
+static_assert(std::is_trivially_copyable_v<Header> && sizeof(Header) % 8 == 0);
+static_assert(std::is_trivially_copyable_v<SectionEntry> && sizeof(SectionEntry) == 32);
+} // namespace
+
+static uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Copies one attribute of all the particles into a contiguous array
+template<typename T>
+static std::vector<std::byte> gather(std::span<Particle const> particles, T Particle::*member)
+{
+    std::vector<std::byte> bytes(particles.size() * sizeof(T));
+    parallel::for_each_index(particles.size(), [&](size_t i) {
+        std::memcpy(bytes.data() + i * sizeof(T), &(particles[i].*member), sizeof(T));
+    });
+    return bytes;
+}
+
+template<typename T>
+static std::vector<std::byte> to_bytes(std::vector<T> const& values)
+{
+    std::vector<std::byte> bytes(values.size() * sizeof(T));
+    std::memcpy(bytes.data(), values.data(), bytes.size());
+    return bytes;
+}
+
+#if defined(PARTICLES_HAS_ZSTD)
+static uint64_t blocks_count(uint64_t rawSize)
+{
+    return (rawSize + blockSize - 1) / blockSize;
+}
+
+static std::vector<std::byte> compress(std::span<std::byte const> raw)
+{
+    size_t const count = blocks_count(raw.size());
+    std::vector<std::vector<std::byte>> blocks(count);
+    std::atomic<bool> failed = false;
+    parallel::for_each_index(count, [&](size_t i) {
+        auto const input = raw.subspan(i * blockSize, std::min<size_t>(blockSize, raw.size() - i * blockSize));
+        blocks[i].resize(ZSTD_compressBound(input.size()));
+        size_t const size = ZSTD_compress(blocks[i].data(), blocks[i].size(), input.data(), input.size(), 3);
+        if (ZSTD_isError(size))
+            failed = true;
+        else
+            blocks[i].resize(size);
+    }, 1);
+    if (failed)
+        throw std::runtime_error{"[snapshot] Compression failed"};
+
+    std::vector<std::byte> result((1 + count) * sizeof(uint64_t));
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t const size = blocks[i].size();
+        std::memcpy(result.data() + (1 + i) * sizeof(uint64_t), &size, sizeof(size));
+        result.insert(result.end(), blocks[i].begin(), blocks[i].end());
+    }
+    uint64_t const count64 = count;
+    std::memcpy(result.data(), &count64, sizeof(count64));
+    return result;
+}
+
+static std::vector<std::byte> decompress(std::span<std::byte const> stored, uint64_t rawSize)
+{
+    auto const fail = []() { throw std::runtime_error{"[snapshot] Corrupted compressed section"}; };
+
+    uint64_t count;
+    if (stored.size() < sizeof(count))
+        fail();
+    std::memcpy(&count, stored.data(), sizeof(count));
+    if (count != blocks_count(rawSize) || stored.size() < (1 + count) * sizeof(uint64_t))
+        fail();
+
+    // Offsets of the blocks, computed up front so that they can be decompressed in parallel
+    std::vector<uint64_t> offsets(count + 1);
+    offsets[0] = (1 + count) * sizeof(uint64_t);
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t size;
+        std::memcpy(&size, stored.data() + (1 + i) * sizeof(uint64_t), sizeof(size));
+        offsets[i + 1] = offsets[i] + size;
+    }
+    if (offsets.back() > stored.size())
+        fail();
+
+    std::vector<std::byte> raw(static_cast<size_t>(rawSize));
+    std::atomic<bool> corrupted = false;
+    parallel::for_each_index(count, [&](size_t i) {
+        size_t const expected = std::min<size_t>(blockSize, raw.size() - i * blockSize);
+        size_t const size = ZSTD_decompress(raw.data() + i * blockSize, expected, stored.data() + offsets[i], offsets[i + 1] - offsets[i]);
+        if (ZSTD_isError(size) || size != expected)
+            corrupted = true;
+    }, 1);
+    if (corrupted)
+        fail();
+    return raw;
+}
+#else
+static std::vector<std::byte> compress(std::span<std::byte const>)
+{
+    throw std::runtime_error{"[snapshot] Compression is not available, build with PARTICLES_ENABLE_ZSTD"};
+}
+
+static std::vector<std::byte> decompress(std::span<std::byte const>, uint64_t)
+{
+    throw std::runtime_error{"[snapshot] The snapshot is compressed, build with PARTICLES_ENABLE_ZSTD to read it"};
+}
+#endif
+
+void save(std::filesystem::path const& path, std::span<Particle const> particles, Obstacles const& obstacles, Compression compression)
+{
+    std::array<std::vector<std::byte>, Snapshot::sectionsCount> sections;
+    std::array<uint32_t, Snapshot::sectionsCount>               elementSizes{8, 8, 4, 4, 4, 4, 16, 16, 16, 12};
+    sections[Positions]   = gather(particles, &Particle::position);
+    sections[Velocities]  = gather(particles, &Particle::velocity);
+    sections[Masses]      = gather(particles, &Particle::mass);
+    sections[Lifetimes]   = gather(particles, &Particle::lifetime);
+    sections[Ages]        = gather(particles, &Particle::age);
+    sections[StartRadii]  = gather(particles, &Particle::startRadius);
+    sections[StartColors] = gather(particles, &Particle::startColor);
+    sections[EndColors]   = gather(particles, &Particle::endColor);
+    sections[Lines]       = to_bytes(obstacles.lines);
+    sections[Circles]     = to_bytes(obstacles.circles);
+
+    Header header{};
+    header.magic          = magic;
+    header.version        = version;
+    header.flags          = compression == Compression::None ? 0 : compressedFlag;
+    header.particlesCount = particles.size();
+    header.linesCount     = obstacles.lines.size();
+    header.circlesCount   = obstacles.circles.size();
+    header.blockSize      = blockSize;
+    header.sectionsCount  = Snapshot::sectionsCount;
+
+    std::array<SectionEntry, Snapshot::sectionsCount> table{};
+    uint64_t offset = sizeof(Header) + sizeof(table);
+    for (uint32_t i = 0; i < Snapshot::sectionsCount; ++i) {
+        table[i].id          = i;
+        table[i].elementSize = elementSizes[i];
+        table[i].rawSize     = sections[i].size();
+        if (compression != Compression::None)
+            sections[i] = compress(sections[i]);
+        offset               = align_up(offset, sectionAlignment);
+        table[i].offset      = offset;
+        table[i].storedSize  = sections[i].size();
+        offset += sections[i].size();
+    }
+
+    // Written next to the final file then renamed, so that a crash never leaves a half-written snapshot behind
+    auto tempPath = path;
+    tempPath += ".tmp";
+    {
+        auto file = std::ofstream{tempPath, std::ios::binary | std::ios::trunc};
+        auto const write = [&](void const* data, size_t size) { file.write(static_cast<char const*>(data), static_cast<std::streamsize>(size)); };
+        write(&header, sizeof(header));
+        write(table.data(), sizeof(table));
+        uint64_t position = sizeof(Header) + sizeof(table);
+        std::array<char, sectionAlignment> const padding{};
+        for (uint32_t i = 0; i < Snapshot::sectionsCount; ++i) {
+            write(padding.data(), table[i].offset - position);
+            write(sections[i].data(), sections[i].size());
+            position = table[i].offset + sections[i].size();
+        }
+        if (!file)
+            throw std::runtime_error{"[snapshot] Failed to write \"" + tempPath.string() + "\""};
+    }
+    std::filesystem::rename(tempPath, path);
+}
+
+Snapshot::Snapshot(std::filesystem::path const& path)
+    : _file{path}
+{
+    auto const bytes = _file.bytes();
+    auto const fail = [&](char const* reason) {
+        throw std::runtime_error{"[snapshot] Invalid snapshot \"" + path.string() + "\": " + reason};
+    };
+
+    Header header;
+    std::array<SectionEntry, sectionsCount> table;
+    if (bytes.size() < sizeof(header) + sizeof(table))
+        fail("file too small");
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (header.magic != magic)
+        fail("not a snapshot");
+    if (header.version != version)
+        fail("unsupported version");
+    if (header.sectionsCount != sectionsCount || header.blockSize != blockSize)
+        fail("unsupported layout");
+    std::memcpy(table.data(), bytes.data() + sizeof(header), sizeof(table));
+
+    _particlesCount = static_cast<size_t>(header.particlesCount);
+    bool const compressed = (header.flags & compressedFlag) != 0;
+    if (compressed)
+        _decompressedSections.resize(sectionsCount);
+
+    for (size_t i = 0; i < sectionsCount; ++i) {
+        auto const& entry = table[i];
+        uint64_t const count = i == Lines ? header.linesCount : i == Circles ? header.circlesCount : header.particlesCount;
+        if (entry.id != i || entry.rawSize != count * entry.elementSize)
+            fail("unexpected section");
+        if (entry.offset % sectionAlignment != 0 || entry.offset > bytes.size() || entry.storedSize > bytes.size() - entry.offset)
+            fail("truncated");
+
+        auto const stored = bytes.subspan(static_cast<size_t>(entry.offset), static_cast<size_t>(entry.storedSize));
+        if (!compressed) {
+            if (entry.storedSize != entry.rawSize)
+                fail("unexpected section size");
+            _sections[i] = stored;
+        } else {
+            _decompressedSections[i] = decompress(stored, entry.rawSize);
+            _sections[i] = _decompressedSections[i];
+        }
+    }
+}
+
+template<typename T>
+std::span<T const> Snapshot::section(size_t index) const
+{
+    auto const bytes = _sections[index];
+    return {reinterpret_cast<T const*>(bytes.data()), bytes.size() / sizeof(T)};
+}
+
+std::span<glm::vec2 const> Snapshot::positions() const { return section<glm::vec2>(Positions); }
+std::span<glm::vec2 const> Snapshot::velocities() const { return section<glm::vec2>(Velocities); }
+std::span<float const>     Snapshot::masses() const { return section<float>(Masses); }
+std::span<float const>     Snapshot::lifetimes() const { return section<float>(Lifetimes); }
+std::span<float const>     Snapshot::ages() const { return section<float>(Ages); }
+std::span<float const>     Snapshot::start_radii() const { return section<float>(StartRadii); }
+std::span<glm::vec4 const> Snapshot::start_colors() const { return section<glm::vec4>(StartColors); }
+std::span<glm::vec4 const> Snapshot::end_colors() const { return section<glm::vec4>(EndColors); }
+std::span<Line const>      Snapshot::lines() const { return section<Line>(Lines); }
+std::span<Circle const>    Snapshot::circles() const { return section<Circle>(Circles); }
+
+void Snapshot::restore(std::vector<Particle>& particles, Obstacles& obstacles) const
+{
+    // Every field is overwritten below, the constructor only gives us storage
+    particles.assign(_particlesCount, Particle{glm::vec2{0.f}});
+    parallel::for_each_index(_particlesCount, [&](size_t i) {
+        auto& particle       = particles[i];
+        particle.position    = positions()[i];
+        particle.velocity    = velocities()[i];
+        particle.mass        = masses()[i];
+        particle.lifetime    = lifetimes()[i];
+        particle.age         = ages()[i];
+        particle.startRadius = start_radii()[i];
+        particle.startColor  = start_colors()[i];
+        particle.endColor    = end_colors()[i];
+    });
+    obstacles.lines.assign(lines().begin(), lines().end());
+    obstacles.circles.assign(circles().begin(), circles().end());
+}
+
+} // namespace snapshot
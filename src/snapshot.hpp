@@ -0,0 +1,57 @@
+#pragma once
+#include <array>
+#include <filesystem>
+#include <span>
+#include <vector>
+#include "glm/glm.hpp"
+#include "mapped_file.hpp"
+#include "Struct/Obstacles.hpp"
+#include "Struct/Particles.hpp"
+
+namespace snapshot {
+
+enum class Compression {
+    None, // The file can be mapped and used directly
+    Zstd, // Smaller files, but the sections have to be decompressed when opening. Requires building with PARTICLES_ENABLE_ZSTD.
+};
+
+// Saves the particles and the obstacles in a versioned little-endian file, with one array per particle attribute (SoA).
+// Throws a std::runtime_error on failure.
+void save(std::filesystem::path const& path, std::span<Particle const> particles, Obstacles const& obstacles, Compression compression = Compression::None);
+
+// A snapshot file mapped in memory. When it is not compressed the arrays point directly into the file, there is no parsing nor copy.
+class Snapshot {
+public:
+    // Throws a std::runtime_error if the file doesn't exist or isn't a valid snapshot
+    explicit Snapshot(std::filesystem::path const& path);
+
+    size_t particles_count() const { return _particlesCount; }
+
+    std::span<glm::vec2 const> positions() const;
+    std::span<glm::vec2 const> velocities() const;
+    std::span<float const>     masses() const;
+    std::span<float const>     lifetimes() const;
+    std::span<float const>     ages() const;
+    std::span<float const>     start_radii() const;
+    std::span<glm::vec4 const> start_colors() const;
+    std::span<glm::vec4 const> end_colors() const;
+    std::span<Line const>      lines() const;
+    std::span<Circle const>    circles() const;
+
+    // Replaces the content of particles and obstacles with the one of the snapshot
+    void restore(std::vector<Particle>& particles, Obstacles& obstacles) const;
+
+    static constexpr size_t sectionsCount = 10;
+
+private:
+    template<typename T>
+    std::span<T const> section(size_t index) const;
+
+private:
+    MappedFile                                            _file;
+    size_t                                                _particlesCount{0};
+    std::array<std::span<std::byte const>, sectionsCount> _sections{};
+    std::vector<std::vector<std::byte>>                   _decompressedSections{}; // Only used by compressed files
+};
+
+} // namespace snapshot
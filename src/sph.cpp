@@ -0,0 +1,273 @@
+#include "sph.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include "collision.hpp"
+#include "parallel.hpp"
+
+namespace sph {
+
+// ------ Kernels (2D versions of the ones from Müller et al. 2003) ------
+
+static float poly6(float distanceSquared, float h)
+{
+    float const hSquared = h * h;
+    if (distanceSquared >= hSquared)
+        return 0.f;
+    float const x = hSquared - distanceSquared;
+    return 4.f / (glm::pi<float>() * std::pow(h, 8.f)) * x * x * x;
+}
+
+static glm::vec2 spiky_gradient(glm::vec2 offset, float distance, float h)
+{
+    if (distance >= h || distance <= 1e-6f)
+        return glm::vec2{0.f};
+    float const x = h - distance;
+    return -30.f / (glm::pi<float>() * std::pow(h, 5.f)) * x * x * (offset / distance);
+}
+
+static float viscosity_laplacian(float distance, float h)
+{
+    if (distance >= h)
+        return 0.f;
+    return 40.f / (glm::pi<float>() * std::pow(h, 5.f)) * (h - distance);
+}
+
+// ------ Neighbor grid ------
+
+glm::ivec2 NeighborGrid::cell_of(glm::vec2 position) const
+{
+    return glm::ivec2{glm::floor(position / _cellSize)};
+}
+
+uint32_t NeighborGrid::bucket_of(glm::ivec2 cell) const
+{
+    auto const hash = static_cast<uint32_t>(cell.x) * 73856093u ^ static_cast<uint32_t>(cell.y) * 19349663u;
+    return hash & static_cast<uint32_t>(_bucketStarts.size() - 2); // Buckets count is a power of 2
+}
+
+void NeighborGrid::build(std::span<Particle const> particles, float cellSize)
+{
+    _cellSize = cellSize;
+    size_t const bucketsCount = std::bit_ceil(std::max<size_t>(2 * particles.size(), 64));
+    _bucketStarts.assign(bucketsCount + 1, 0);
+    _particleBuckets.resize(particles.size());
+    _sortedIndices.resize(particles.size());
+
+    parallel::for_each_index(particles.size(), [&](size_t i) {
+        _particleBuckets[i] = bucket_of(cell_of(particles[i].position));
+    });
+
+    // Counting sort of the particles by bucket
+    for (uint32_t bucket : _particleBuckets)
+        _bucketStarts[bucket + 1]++;
+    for (size_t i = 1; i < _bucketStarts.size(); ++i)
+        _bucketStarts[i] += _bucketStarts[i - 1];
+    std::pmr::vector<uint32_t> cursors(_bucketStarts.begin(), _bucketStarts.end() - 1, &gl::frame_arena());
+    for (uint32_t i = 0; i < particles.size(); ++i)
+        _sortedIndices[cursors[_particleBuckets[i]]++] = i;
+}
+
+template<typename Callback>
+void NeighborGrid::for_each_bucket_around(glm::vec2 position, Callback&& callback) const
+{
+    glm::ivec2 const cell = cell_of(position);
+    std::array<uint32_t, 9> visited{};
+    int visitedCount = 0;
+    for (int dx = -1; dx <= 1; ++dx) {
+        for (int dy = -1; dy <= 1; ++dy) {
+            uint32_t const bucket = bucket_of(cell + glm::ivec2{dx, dy});
+            // Two neighboring cells can land in the same bucket: only visit it once
+            if (std::find(visited.begin(), visited.begin() + visitedCount, bucket) != visited.begin() + visitedCount)
+                continue;
+            visited[visitedCount++] = bucket;
+            callback(_bucketStarts[bucket], _bucketStarts[bucket + 1]);
+        }
+    }
+}
+
+// ------ Solver ------
+
+Solver::Solver(Settings const& settings)
+    : _settings{settings}
+{}
+
+bool Solver::neighbors_are_stale(std::span<Particle const> particles) const
+{
+    if (_positionsAtLastBuild.size() != particles.size())
+        return true;
+
+    // The lists contain everything within kernelRadius + neighborSkin, so they stay valid until a particle has moved by half the skin
+    float const maxDisplacement = 0.5f * _settings.neighborSkin;
+    float const maxDisplacementSquared = maxDisplacement * maxDisplacement;
+    for (size_t i = 0; i < particles.size(); ++i) {
+        glm::vec2 const displacement = particles[i].position - _positionsAtLastBuild[i];
+        if (glm::dot(displacement, displacement) > maxDisplacementSquared)
+            return true;
+    }
+    return false;
+}
+
+void Solver::rebuild_neighbors(std::span<Particle const> particles)
+{
+    float const searchRadius = _settings.kernelRadius + _settings.neighborSkin;
+    float const searchRadiusSquared = searchRadius * searchRadius;
+    _grid.build(particles, searchRadius);
+
+    auto const sorted = _grid.sorted_indices();
+    auto const for_each_candidate = [&](size_t i, auto&& callback) {
+        glm::vec2 const position = particles[i].position;
+        _grid.for_each_bucket_around(position, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t k = begin; k < end; ++k) {
+                uint32_t const j = sorted[k];
+                glm::vec2 const offset = particles[j].position - position;
+                if (j != i && glm::dot(offset, offset) < searchRadiusSquared)
+                    callback(j);
+            }
+        });
+    };
+
+    // Count, then fill, so that each particle writes its own row without any synchronization
+    _neighborStarts.assign(particles.size() + 1, 0);
+    parallel::for_each_index(particles.size(), [&](size_t i) {
+        uint32_t count = 0;
+        for_each_candidate(i, [&](uint32_t) { count++; });
+        _neighborStarts[i + 1] = count;
+    });
+    for (size_t i = 1; i < _neighborStarts.size(); ++i)
+        _neighborStarts[i] += _neighborStarts[i - 1];
+    _neighbors.resize(_neighborStarts.back());
+    parallel::for_each_index(particles.size(), [&](size_t i) {
+        uint32_t cursor = _neighborStarts[i];
+        for_each_candidate(i, [&](uint32_t j) { _neighbors[cursor++] = j; });
+    });
+
+    _positionsAtLastBuild.resize(particles.size());
+    for (size_t i = 0; i < particles.size(); ++i)
+        _positionsAtLastBuild[i] = particles[i].position;
+}
+
+void Solver::compute_densities(std::span<Particle const> particles)
+{
+    float const h = _settings.kernelRadius;
+    parallel::for_each_index(particles.size(), [&](size_t i) {
+        float density = particles[i].mass * poly6(0.f, h);
+        for (uint32_t k = _neighborStarts[i]; k < _neighborStarts[i + 1]; ++k) {
+            uint32_t const j = _neighbors[k];
+            glm::vec2 const offset = particles[j].position - particles[i].position;
+            density += particles[j].mass * poly6(glm::dot(offset, offset), h);
+        }
+        _densities[i] = density;
+    });
+
+    if (_restDensity <= 0.f) {
+        if (_settings.restDensity > 0.f) {
+            _restDensity = _settings.restDensity;
+        } else {
+            // Calibrate on the initial configuration, so that the fluid starts at rest
+            double sum = 0.;
+            for (float density : _densities)
+                sum += density;
+            _restDensity = static_cast<float>(sum / static_cast<double>(std::max<size_t>(_densities.size(), 1)));
+        }
+    }
+
+    parallel::for_each_index(particles.size(), [&](size_t i) {
+        // Clamped at 0 to avoid the tensile instability that makes particles clump together
+        _pressures[i] = std::max(0.f, _settings.stiffness * _restDensity * (_densities[i] / _restDensity - 1.f));
+    });
+}
+
+void Solver::compute_accelerations(std::span<Particle const> particles)
+{
+    float const h = _settings.kernelRadius;
+    parallel::for_each_index(particles.size(), [&](size_t i) {
+        Particle const& pi = particles[i];
+        glm::vec2 pressureForce{0.f};
+        glm::vec2 viscosityForce{0.f};
+        for (uint32_t k = _neighborStarts[i]; k < _neighborStarts[i + 1]; ++k) {
+            uint32_t const j = _neighbors[k];
+            Particle const& pj = particles[j];
+            glm::vec2 const offset = pi.position - pj.position;
+            float const distance = glm::length(offset);
+            if (distance >= h)
+                continue; // Only in the list thanks to the skin
+
+            pressureForce -= pj.mass * (_pressures[i] + _pressures[j]) / (2.f * _densities[j]) * spiky_gradient(offset, distance, h);
+            viscosityForce += pj.mass * (pj.velocity - pi.velocity) / _densities[j] * viscosity_laplacian(distance, h);
+        }
+        _accelerations[i] = pressureForce / _densities[i] + _settings.viscosity * viscosityForce + _settings.gravity;
+    });
+}
+
+void Solver::integrate(std::span<Particle> particles, Obstacles const& obstacles, float dt)
+{
+    float const keptNormalVelocity = _settings.restitution;
+    parallel::for_each_index(particles.size(), [&](size_t i) {
+        Particle& particle = particles[i];
+        particle.velocity += _accelerations[i] * dt;
+
+        glm::vec2 const previousPos = particle.position;
+        glm::vec2 nextPos = previousPos + particle.velocity * dt;
+
+        // Lines: stop on the wall and cancel the velocity going through it
+        for (const auto& line : obstacles.lines) {
+            glm::vec2 intersection;
+            if (!collision::intersect_segments(previousPos, nextPos, line.p1, line.p2, intersection))
+                continue;
+            glm::vec2 edge = line.p2 - line.p1;
+            glm::vec2 normal = glm::normalize(glm::vec2(-edge.y, edge.x));
+            if (glm::dot(normal, previousPos - line.p1) < 0.f)
+                normal = -normal; // Pointing towards the side the particle comes from
+
+            nextPos = intersection + normal * 1e-4f;
+            float const normalSpeed = glm::dot(particle.velocity, normal);
+            if (normalSpeed < 0.f)
+                particle.velocity -= (1.f + keptNormalVelocity) * normalSpeed * normal;
+        }
+
+        // Circles: push the particle back to the surface
+        for (const auto& circle : obstacles.circles) {
+            glm::vec2 const offset = nextPos - circle.center;
+            float const distance = glm::length(offset);
+            if (distance >= circle.radius)
+                continue;
+            glm::vec2 const normal = distance > 1e-6f ? offset / distance : glm::vec2{0.f, 1.f};
+            nextPos = circle.center + normal * circle.radius;
+            float const normalSpeed = glm::dot(particle.velocity, normal);
+            if (normalSpeed < 0.f)
+                particle.velocity -= (1.f + keptNormalVelocity) * normalSpeed * normal;
+        }
+
+        particle.position = nextPos;
+    });
+}
+
+void Solver::substep(std::span<Particle> particles, Obstacles const& obstacles, float dt)
+{
+    if (neighbors_are_stale(particles))
+        rebuild_neighbors(particles);
+
+    _densities.resize(particles.size());
+    _pressures.resize(particles.size());
+    _accelerations.resize(particles.size());
+
+    compute_densities(particles);
+    compute_accelerations(particles);
+    integrate(particles, obstacles, dt);
+}
+
+void Solver::step(std::span<Particle> particles, Obstacles const& obstacles, float dt)
+{
+    if (particles.empty() || dt <= 0.f)
+        return;
+
+    int const substepsCount = std::clamp(static_cast<int>(std::ceil(dt / _settings.maxTimeStep)), 1, std::max(_settings.maxSubsteps, 1));
+    float const substepDt = dt / static_cast<float>(substepsCount);
+    for (int i = 0; i < substepsCount; ++i)
+        substep(particles, obstacles, substepDt);
+}
+
+} // namespace sph
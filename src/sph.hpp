@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "glm/glm.hpp"
+#include "Struct/Obstacles.hpp"
+#include "Struct/Particles.hpp"
+
+namespace sph {
+
+struct Settings {
+    float     kernelRadius   = 0.05f;          // Smoothing length h: particles further apart than this don't interact
+    float     stiffness      = 20.f;           // How strongly the fluid resists compression
+    float     viscosity      = 0.005f;         // Kinematic viscosity
+    float     restDensity    = 0.f;            // Target density. 0 means "use the average density of the first step"
+    glm::vec2 gravity        = {0.f, -2.f};
+    float     restitution    = 0.2f;           // Fraction of the normal velocity kept when bouncing on an obstacle
+    float     neighborSkin   = 0.01f;          // Extra search distance that lets us reuse the neighbor lists for several steps
+    float     maxTimeStep    = 1.f / 480.f;    // The frame dt is split into substeps no longer than this
+    int       maxSubsteps    = 10;
+};
+
+// Spatial hash of the particles, with cells of the size of the search radius
+class NeighborGrid {
+public:
+    void build(std::span<Particle const> particles, float cellSize);
+
+    // Calls callback(bucket_begin, bucket_end) for each (distinct) bucket overlapping the 3x3 cells around position
+    template<typename Callback>
+    void for_each_bucket_around(glm::vec2 position, Callback&& callback) const;
+
+    std::span<uint32_t const> sorted_indices() const { return _sortedIndices; }
+
+private:
+    uint32_t bucket_of(glm::ivec2 cell) const;
+    glm::ivec2 cell_of(glm::vec2 position) const;
+
+private:
+    float                 _cellSize{1.f};
+    std::vector<uint32_t> _particleBuckets{};
+    std::vector<uint32_t> _bucketStarts{};   // size: buckets count + 1
+    std::vector<uint32_t> _sortedIndices{};  // Particle indices, sorted by bucket
+};
+
+// Smoothed-particle hydrodynamics: turns the particles into a weakly compressible fluid
+class Solver {
+public:
+    explicit Solver(Settings const& settings = {});
+
+    Settings&       settings() { return _settings; }
+    Settings const& settings() const { return _settings; }
+
+    void step(std::span<Particle> particles, Obstacles const& obstacles, float dt);
+
+    // Per-particle values computed during the last substep
+    std::span<float const> densities() const { return _densities; }
+    std::span<float const> pressures() const { return _pressures; }
+
+    // Forces a full rebuild of the neighbor lists on the next step (e.g. after teleporting particles)
+    void invalidate_neighbors() { _positionsAtLastBuild.clear(); }
+
+private:
+    void substep(std::span<Particle> particles, Obstacles const& obstacles, float dt);
+    bool neighbors_are_stale(std::span<Particle const> particles) const;
+    void rebuild_neighbors(std::span<Particle const> particles);
+    void compute_densities(std::span<Particle const> particles);
+    void compute_accelerations(std::span<Particle const> particles);
+    void integrate(std::span<Particle> particles, Obstacles const& obstacles, float dt);
+
+private:
+    Settings _settings;
+    float    _restDensity{0.f};
+
+    // Cached neighbor lists (compressed rows: the neighbors of i are _neighbors[_neighborStarts[i] .. _neighborStarts[i+1]])
+    NeighborGrid           _grid{};
+    std::vector<glm::vec2> _positionsAtLastBuild{};
+    std::vector<uint32_t>  _neighborStarts{};
+    std::vector<uint32_t>  _neighbors{};
+
+    std::vector<float>     _densities{};
+    std::vector<float>     _pressures{};
+    std::vector<glm::vec2> _accelerations{};
+};
+
+} // namespace sph
@@ -18,19 +18,21 @@ float rand(float min, float max)
 
 static auto make_square_mesh() -> gl::Mesh
 {
+    static constexpr float vertices[] = {
+        -1.f, -1.f, 0.f, 0.f, //
+        +1.f, -1.f, 1.f, 0.f, //
+        +1.f, +1.f, 1.f, 1.f, //
+        -1.f, +1.f, 0.f, 1.f  //
+    };
+    static constexpr uint32_t indices[] = {0, 1, 2, 0, 2, 3};
     return gl::Mesh{gl::Mesh_Descriptor{
         .vertex_buffers = {
             gl::VertexBuffer_Descriptor{
                 .layout = {gl::VertexAttribute::Position2D(0), gl::VertexAttribute::UV(1)},
-                .data   = {
-                    -1.f, -1.f, 0.f, 0.f, //
-                    +1.f, -1.f, 1.f, 0.f, //
-                    +1.f, +1.f, 1.f, 1.f, //
-                    -1.f, +1.f, 0.f, 1.f  //
-                }
+                .data   = std::as_bytes(std::span{vertices}),
             }
         },
-        .index_buffer = {0, 1, 2, 0, 2, 3},
+        .index_buffer = indices,
     }};
 }
 
@@ -155,11 +157,11 @@ std::vector<glm::vec2> poisson_disc_sampling(glm::vec2 center, float radius, flo
     float cellSize = minDist / std::sqrt(2.f);
     int gridSize = static_cast<int>(std::ceil((2 * radius) / cellSize));
 
-    // Grille 2D (flattened), -1 = pas de point
-    std::vector<int> grid(gridSize * gridSize, -1);
+    // Grille 2D (flattened), -1 = pas de point. Les tableaux temporaires sont pris dans la mémoire de l'image en cours.
+    std::pmr::vector<int> grid(static_cast<size_t>(gridSize * gridSize), -1, &gl::frame_arena());
 
     std::vector<glm::vec2> samples;
-    std::vector<glm::vec2> activeList;
+    std::pmr::vector<glm::vec2> activeList{&gl::frame_arena()};
 
     // Place initial point au centre
     samples.push_back(center);